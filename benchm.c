@@ -0,0 +1,319 @@
+/*
+  A C program to benchmark the matching functions (for master-mind):
+  the C version, the Assembler version in mm-matches.s, the all-pairs table,
+  the packed single-pair kernel, the SIMD batch kernel and the batch entry of the
+  Assembler version.
+
+$ make bench
+  or
+$ ./benchm [-L <length>] [-C <colours>] [-n <samples>] [-k <pairs per sample>] [-s <seed>]
+
+  Every kernel is warmed up, then timed over <samples> samples of <pairs per sample>
+  scored pairs each (2000 x 1024, i.e. about 2 million pairs, by default), using
+  clock_gettime(CLOCK_MONOTONIC) and, where the CPU has one, a tick counter.
+  The results go to stdout as CSV, one line per kernel, with the per-pair time of
+  the fastest, median and 99th percentile sample; lines starting with # are comments.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+
+#if defined(__x86_64__)
+#include <x86intrin.h>
+#endif
+
+#if defined(__arm__)
+#include <sys/auxv.h>
+#ifndef HWCAP_NEON
+#define HWCAP_NEON (1 << 12)
+#endif
+#endif
+
+#include "mm-table.h"
+#include "mm-codes.h"
+
+#define LENGTH 3
+#define COLORS 3
+
+// number of distinct random pairs the kernels cycle through (a power of 2)
+#define NPAIRS 1024
+// fraction of the samples run, and thrown away, before timing starts
+#define WARMUP_DIV 10
+
+static int seqlen = LENGTH;
+static int seqmax = COLORS;
+
+/* ********************************** */
+/* take these fcts from master-mind.c */
+/* ********************************** */
+
+/* counts how many entries in seq2 match entries in seq1 */
+/* returns exact and approximate matches, encoded in a single value */
+int countMatches(int *seq1, int *seq2)
+{
+  int exactMatches = 0;
+  int approximateMatches = 0;
+
+  int seq1Matched[MAX_SEQL] = {0};
+  int seq2Matched[MAX_SEQL] = {0};
+
+  // Count exact matches
+  for (int i = 0; i < seqlen; i++)
+  {
+    if (seq1[i] == seq2[i])
+    {
+      exactMatches++;
+      seq1Matched[i] = 1;
+      seq2Matched[i] = 1;
+    }
+  }
+
+  // Count approximate matches
+  for (int i = 0; i < seqlen; i++)
+  {
+    if (!seq1Matched[i])
+    {
+      for (int j = 0; j < seqlen; j++)
+      {
+        if (!seq2Matched[j] && seq1[i] == seq2[j])
+        {
+          approximateMatches++;
+          seq1Matched[i] = 1;
+          seq2Matched[j] = 1;
+          break;
+        }
+      }
+    }
+  }
+
+  return MATCH_ENCODE(exactMatches, approximateMatches);
+}
+
+// The ARM assembler version of the matching fct
+extern int matches(int *val1, int *val2);
+
+// its batch entry (NEON, or SSE2 on x86-64)
+extern void matchesBatch(seq_t guess, const seq_t *codes, int n, unsigned char *out);
+
+/* 1 if this CPU can run matchesBatch: 32-bit ARM cores may lack NEON, so ask */
+/* the kernel; the rest of this program is built without NEON, to run anyway */
+static int haveMatchesBatch(void)
+{
+#if defined(__arm__)
+  return (getauxval(AT_HWCAP) & HWCAP_NEON) != 0;
+#else
+  return 1;
+#endif
+}
+
+// +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+
+// the random input pairs, in every representation the kernels need
+static int ints1[NPAIRS * MAX_SEQL], ints2[NPAIRS * MAX_SEQL];
+static int idx1[NPAIRS], idx2[NPAIRS];
+static seq_t packed1[NPAIRS], packed2[NPAIRS];
+static unsigned char answers[NPAIRS];
+
+// results are summed up here, so that the compiler cannot drop the calls
+static volatile int sink;
+
+/* a timestamp in nanoseconds */
+static inline uint64_t nowNs(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+/* a raw tick count, or 0 if there is no tick counter we can read from user space */
+static inline uint64_t nowTicks(void)
+{
+#if defined(__x86_64__)
+  return __rdtsc();
+#elif defined(__aarch64__)
+  uint64_t t;
+  asm volatile("mrs %0, cntvct_el0" : "=r"(t));
+  return t;
+#else
+  return 0;
+#endif
+}
+
+static const char *tickSource(void)
+{
+#if defined(__x86_64__)
+  return "rdtsc";
+#elif defined(__aarch64__)
+  return "cntvct_el0";
+#else
+  return "none";
+#endif
+}
+
+/* score @k@ pairs with kernel @kernel@, starting at pair @start@ */
+static void runKernel(int kernel, int start, int k)
+{
+  int i, j, sum = 0;
+
+  switch (kernel)
+  {
+  case 0: // C version
+    for (i = 0; i < k; i++)
+    {
+      j = (start + i) & (NPAIRS - 1);
+      sum += countMatches(ints1 + j * MAX_SEQL, ints2 + j * MAX_SEQL);
+    }
+    break;
+  case 1: // Assembler version
+    for (i = 0; i < k; i++)
+    {
+      j = (start + i) & (NPAIRS - 1);
+      sum += matches(ints1 + j * MAX_SEQL, ints2 + j * MAX_SEQL);
+    }
+    break;
+  case 2: // all-pairs table
+    for (i = 0; i < k; i++)
+    {
+      j = (start + i) & (NPAIRS - 1);
+      sum += tableMatches(idx1[j], idx2[j]);
+    }
+    break;
+  case 3: // packed single-pair kernel
+    for (i = 0; i < k; i++)
+    {
+      j = (start + i) & (NPAIRS - 1);
+      sum += countMatchesPacked(packed1[j], packed2[j]);
+    }
+    break;
+  case 4: // batch kernel, one guess against NPAIRS candidates per call
+    for (i = 0; i < k; i += NPAIRS)
+    {
+      j = (start + i / NPAIRS) & (NPAIRS - 1);
+      countMatchesBatch(packed1[j], packed2, k - i < NPAIRS ? k - i : NPAIRS, answers);
+      sum += answers[j];
+    }
+    break;
+  case 5: // batch entry of the Assembler version
+    for (i = 0; i < k; i += NPAIRS)
+    {
+      j = (start + i / NPAIRS) & (NPAIRS - 1);
+      matchesBatch(packed1[j], packed2, k - i < NPAIRS ? k - i : NPAIRS, answers);
+      sum += answers[j];
+    }
+    break;
+  }
+  sink += sum;
+}
+
+static int cmpDouble(const void *a, const void *b)
+{
+  double x = *(const double *)a, y = *(const double *)b;
+  return (x > y) - (x < y);
+}
+
+// +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+
+int main(int argc, char **argv)
+{
+  static const char *names[] = {"c", "asm", "table", "packed", "batch", "asmbat"};
+  int nsamples = 2000, k = NPAIRS, seed = 1701;
+  int i, j, kernel, opt;
+  double *ns, *ticks;
+
+  while ((opt = getopt(argc, argv, "hL:C:n:k:s:")) != -1)
+  {
+    switch (opt)
+    {
+    case 'L':
+      seqlen = atoi(optarg);
+      break;
+    case 'C':
+      seqmax = atoi(optarg);
+      break;
+    case 'n':
+      nsamples = atoi(optarg);
+      break;
+    case 'k':
+      k = atoi(optarg);
+      break;
+    case 's':
+      seed = atoi(optarg);
+      break;
+    default: /* '?' */
+      fprintf(stderr, "Usage: %s [-h] [-L <length>] [-C <colours>] [-n <samples>] [-k <pairs per sample>] [-s <seed>]\n", argv[0]);
+      exit(opt == 'h' ? EXIT_SUCCESS : EXIT_FAILURE);
+    }
+  }
+  if (codesInit(seqlen, seqmax) != 0 || nsamples < 1 || k < 1)
+  {
+    fprintf(stderr, "Unsupported settings\n");
+    exit(EXIT_FAILURE);
+  }
+  tableInit(seqlen, seqmax, countMatches);
+
+  srand(seed);
+  for (i = 0; i < NPAIRS; i++)
+  {
+    for (j = 0; j < seqlen; j++)
+    {
+      ints1[i * MAX_SEQL + j] = rand() % seqmax + 1;
+      ints2[i * MAX_SEQL + j] = rand() % seqmax + 1;
+    }
+    packed1[i] = packSeq(ints1 + i * MAX_SEQL, seqlen);
+    packed2[i] = packSeq(ints2 + i * MAX_SEQL, seqlen);
+    if (matchTable != NULL)
+    {
+      idx1[i] = tableIndex(ints1 + i * MAX_SEQL);
+      idx2[i] = tableIndex(ints2 + i * MAX_SEQL);
+    }
+  }
+
+  ns = (double *)malloc(nsamples * sizeof(double));
+  ticks = (double *)malloc(nsamples * sizeof(double));
+  if (ns == NULL || ticks == NULL)
+  {
+    fprintf(stderr, "Out of memory\n");
+    exit(EXIT_FAILURE);
+  }
+
+  printf("# seqlen=%d colors=%d samples=%d pairs/sample=%d batch=%s ticks=%s\n",
+         seqlen, seqmax, nsamples, k, codesKernelName(), tickSource());
+  printf("kernel,seqlen,colors,pairs,min_ns,median_ns,p99_ns,median_ticks\n");
+
+  for (kernel = 0; kernel < 6; kernel++)
+  {
+    // the Assembler version is hard-wired to 3 pegs, the table to small code spaces
+    if (((kernel == 1 || kernel == 5) && seqlen != 3) || (kernel == 2 && matchTable == NULL) ||
+        (kernel == 5 && !haveMatchesBatch()))
+    {
+      printf("# %s: skipped for %dx%d\n", names[kernel], seqlen, seqmax);
+      continue;
+    }
+
+    for (i = 0; i < nsamples / WARMUP_DIV; i++)
+      runKernel(kernel, i, k);
+
+    for (i = 0; i < nsamples; i++)
+    {
+      uint64_t t0 = nowNs(), c0 = nowTicks();
+      runKernel(kernel, i, k);
+      uint64_t c1 = nowTicks(), t1 = nowNs();
+      ns[i] = (double)(t1 - t0) / k;
+      ticks[i] = (double)(c1 - c0) / k;
+    }
+    qsort(ns, nsamples, sizeof(double), cmpDouble);
+    qsort(ticks, nsamples, sizeof(double), cmpDouble);
+
+    printf("%s,%d,%d,%lld,%.3f,%.3f,%.3f,%.3f\n", names[kernel], seqlen, seqmax,
+           (long long)nsamples * k, ns[0], ns[nsamples / 2], ns[(nsamples * 99) / 100], ticks[nsamples / 2]);
+    fflush(stdout);
+  }
+
+  free(ns);
+  free(ticks);
+  return 0;
+}
@@ -39,8 +39,18 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
 #include <sys/types.h>
+#include <sys/mman.h>
+#include <sys/ioctl.h>
 #include <time.h>
+#include <linux/gpio.h>
+
+#include "lcdBinary.h"
 
 // -----------------------------------------------------------------------------
 // prototypes
@@ -58,3 +68,338 @@ int failure(int fatal, const char *message, ...);
 // int readButton(uint32_t *gpio, int button);
 
 // void waitForButton(uint32_t *gpio, int button);
+
+// -----------------------------------------------------------------------------
+// GPIO backends (see lcdBinary.h)
+
+static void gpioEdgeCheck(int level);
+static int edgePin = -1;
+
+int gpioBackend = GPIO_BACKEND_MEM;
+
+static volatile uint32_t *gpioRegs; // the mapped register block
+static int gpioFd = -1;
+
+// transitions recorded by the simulated backends; the LCD writer and the main
+// thread may both write pins, so the log is protected by a lock (the level
+// word itself is updated atomically, see gpioSimWrite)
+static pthread_mutex_t gpioLock = PTHREAD_MUTEX_INITIALIZER;
+static struct gpioEvent *gpioLog;
+static size_t gpioLogLen, gpioLogCap;
+static long gpioCount[GPIO_PINS];
+static struct timespec gpioStart;
+
+/* map the GPIO register block of backend @spec@ ("mem", "anon" or "file:PATH", */
+/* see lcdBinary.h); @base@ is the physical address of the real registers.       */
+/* Returns the mapped block, or NULL after printing a message                  */
+uint32_t *gpioOpen(const char *spec, unsigned int base)
+{
+  void *regs;
+  int flags = MAP_SHARED;
+
+  if (strcmp(spec, "mem") == 0)
+  {
+    gpioBackend = GPIO_BACKEND_MEM;
+    if ((gpioFd = open("/dev/mem", O_RDWR | O_SYNC | O_CLOEXEC)) < 0)
+    {
+      fprintf(stderr, "setup: Unable to open /dev/mem: %s (use -G anon to run without the hardware)\n", strerror(errno));
+      return NULL;
+    }
+  }
+  else if (strcmp(spec, "anon") == 0)
+  {
+    gpioBackend = GPIO_BACKEND_ANON;
+    flags = MAP_PRIVATE | MAP_ANONYMOUS;
+    base = 0;
+  }
+  else if (strncmp(spec, "file:", 5) == 0 && spec[5] != '\0')
+  {
+    gpioBackend = GPIO_BACKEND_FILE;
+    base = 0;
+    if ((gpioFd = open(spec + 5, O_RDWR | O_CREAT | O_CLOEXEC, 0644)) < 0 || ftruncate(gpioFd, BLOCK_SIZE) != 0)
+    {
+      fprintf(stderr, "setup: Unable to open %s: %s\n", spec + 5, strerror(errno));
+      return NULL;
+    }
+  }
+  else
+  {
+    fprintf(stderr, "setup: unknown GPIO backend %s; use mem, anon or file:PATH\n", spec);
+    return NULL;
+  }
+
+  regs = mmap(0, BLOCK_SIZE, PROT_READ | PROT_WRITE, flags, gpioFd, base);
+  if (regs == MAP_FAILED)
+  {
+    fprintf(stderr, "setup: mmap (GPIO) failed: %s\n", strerror(errno));
+    return NULL;
+  }
+  gpioRegs = (volatile uint32_t *)regs;
+  clock_gettime(CLOCK_MONOTONIC, &gpioStart);
+  return (uint32_t *)regs;
+}
+
+void gpioClose(void)
+{
+  if (gpioRegs != NULL)
+    munmap((void *)gpioRegs, BLOCK_SIZE);
+  if (gpioFd >= 0)
+    close(gpioFd);
+  gpioRegs = NULL;
+  gpioFd = -1;
+  free(gpioLog);
+  gpioLog = NULL;
+  gpioLogLen = gpioLogCap = 0;
+}
+
+/* simulated backends: update the level register for output pin @pin@, the way */
+/* the hardware does for a write to GPSET/GPCLR, and record any transition;     */
+/* the LCD writer, the game thread and, with file:PATH, a presser process all   */
+/* update the same word, so this is one atomic read-modify-write, and only the  */
+/* caller that actually changed the level records the transition                */
+void gpioSimWrite(int pin, int value)
+{
+  uint32_t *lev = (uint32_t *)(gpioRegs + GPIO_GPLEV0 + pin / 32);
+  uint32_t mask = 1u << (pin % 32), old;
+  struct timespec now;
+
+  if (value)
+    old = __atomic_fetch_or(lev, mask, __ATOMIC_RELAXED);
+  else
+    old = __atomic_fetch_and(lev, ~mask, __ATOMIC_RELAXED);
+  if ((old & mask) == (value ? mask : 0))
+    return;
+
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  pthread_mutex_lock(&gpioLock);
+  gpioCount[pin]++;
+  if (gpioLogLen == gpioLogCap)
+  {
+    size_t cap = gpioLogCap ? 2 * gpioLogCap : 4096;
+    struct gpioEvent *log = (struct gpioEvent *)realloc(gpioLog, cap * sizeof(struct gpioEvent));
+    if (log != NULL)
+    {
+      gpioLog = log;
+      gpioLogCap = cap;
+    }
+  }
+  if (gpioLogLen < gpioLogCap)
+  {
+    gpioLog[gpioLogLen].us = (uint64_t)(now.tv_sec - gpioStart.tv_sec) * 1000000 + (now.tv_nsec - gpioStart.tv_nsec) / 1000;
+    gpioLog[gpioLogLen].pin = pin;
+    gpioLog[gpioLogLen].level = value != 0;
+    gpioLogLen++;
+  }
+  pthread_mutex_unlock(&gpioLock);
+}
+
+/* simulated backends: the same as gpioSimWrite, for a store of @set@ to GPSET0 */
+/* and of @clr@ to GPCLR0, i.e. for all pins in bank 0 at once                  */
+void gpioSimWriteMask(uint32_t set, uint32_t clr)
+{
+  int pin;
+
+  for (pin = 0; pin < 32; pin++)
+    if (set & (1u << pin))
+      gpioSimWrite(pin, 1);
+    else if (clr & (1u << pin))
+      gpioSimWrite(pin, 0);
+}
+
+/* simulated backends: drive input pin @pin@ to @value@, e.g. to press a button */
+void gpioSimSetLevel(int pin, int value)
+{
+  uint32_t *lev = (uint32_t *)(gpioRegs + GPIO_GPLEV0 + pin / 32);
+
+  // atomic, like gpioSimWrite, as other pins of the word change under our feet
+  if (value)
+    __atomic_fetch_or(lev, 1u << (pin % 32), __ATOMIC_RELAXED);
+  else
+    __atomic_fetch_and(lev, ~(1u << (pin % 32)), __ATOMIC_RELAXED);
+  if (pin == edgePin)
+    gpioEdgeCheck(value != 0);
+}
+
+/* number of transitions recorded on output pin @pin@ */
+long gpioTransitions(int pin)
+{
+  return (pin >= 0 && pin < GPIO_PINS) ? gpioCount[pin] : 0;
+}
+
+/* write the recorded transitions to @path@ as CSV (us,pin,level); returns 0 on success */
+int gpioWriteTrace(const char *path)
+{
+  FILE *f = fopen(path, "w");
+  size_t i;
+
+  if (f == NULL)
+    return -1;
+  pthread_mutex_lock(&gpioLock);
+  fprintf(f, "us,pin,level\n");
+  for (i = 0; i < gpioLogLen; i++)
+    fprintf(f, "%llu,%d,%d\n", (unsigned long long)gpioLog[i].us, gpioLog[i].pin, gpioLog[i].level);
+  pthread_mutex_unlock(&gpioLock);
+  return fclose(f);
+}
+
+// -----------------------------------------------------------------------------
+// edge events on one input pin (see gpioEdgeOpen)
+
+// how often the watcher thread samples the level register, in microseconds
+#define GPIO_EDGE_POLL_US 250
+
+static int edgeLineFd = -1;           // gpiochip line-event fd, on the real hardware
+static int edgeStampClock = -1;       // clock of its timestamps, see gpioEdgeStamp; -1 until the first edge
+static int edgePipe[2] = {-1, -1};    // events from the watcher thread, otherwise
+static int edgeLast;                  // last level seen by the watcher
+static volatile int edgeRunning;
+static pthread_t edgeThread;
+static pthread_mutex_t edgeLock = PTHREAD_MUTEX_INITIALIZER;
+
+uint64_t gpioNowUs(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+/* the time of a line event with kernel timestamp @ns@, on the gpioNowUs clock. */
+/* Before Linux 5.7 the kernel stamped line events with CLOCK_REALTIME, since   */
+/* then with CLOCK_MONOTONIC; the first edge tells which clock it is, by which */
+/* one its timestamp is closer to, and realtime stamps are shifted from then on */
+static uint64_t gpioEdgeStamp(uint64_t ns)
+{
+  struct timespec ts;
+  uint64_t now = gpioNowUs(), real, age, us = ns / 1000;
+
+  clock_gettime(CLOCK_REALTIME, &ts);
+  real = (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+  if (edgeStampClock < 0)
+    edgeStampClock = (us > now ? us - now : now - us) <= (us > real ? us - real : real - us) ? CLOCK_MONOTONIC : CLOCK_REALTIME;
+  if (edgeStampClock == CLOCK_MONOTONIC)
+    return us;
+  age = real > us ? real - us : 0; // an event cannot be in the future
+  return age < now ? now - age : 0;
+}
+
+/* a level of @level@ has been seen on the edge pin: if it changed, latch the  */
+/* edge in GPEDS0 (in a simulated block, as the hardware would) and post it    */
+static void gpioEdgeCheck(int level)
+{
+  struct gpioEdge e;
+
+  pthread_mutex_lock(&edgeLock);
+  if (level != edgeLast)
+  {
+    edgeLast = level;
+    if (gpioBackend != GPIO_BACKEND_MEM)
+      gpioRegs[GPIO_GPEDS0 + edgePin / 32] |= 1u << (edgePin % 32);
+    e.us = gpioNowUs();
+    e.pin = edgePin;
+    e.level = level;
+    if (write(edgePipe[1], &e, sizeof(e)) != sizeof(e))
+      fprintf(stderr, "gpio: edge event on pin %d lost\n", edgePin);
+  }
+  pthread_mutex_unlock(&edgeLock);
+}
+
+/* thread body: sample the level of the edge pin, which another process may */
+/* change through a file-backed block, and post its changes                 */
+static void *gpioEdgeWatch(void *arg)
+{
+  struct timespec sleeper = {0, GPIO_EDGE_POLL_US * 1000L};
+
+  (void)arg;
+  while (edgeRunning)
+  {
+    gpioEdgeCheck((gpioRegs[GPIO_GPLEV0 + edgePin / 32] >> (edgePin % 32)) & 1);
+    nanosleep(&sleeper, NULL);
+  }
+  return NULL;
+}
+
+/* start delivering the edges on input pin @pin@; returns a non-blocking file   */
+/* descriptor that becomes readable when there are edges to read with          */
+/* gpioEdgeRead, or -1. On the real hardware the kernel detects the edges, via */
+/* a gpiochip line-event request (it programs GPREN/GPFEN and handles GPEDS;   */
+/* setting those from user space would leave the GPIO interrupt asserted).     */
+/* Otherwise a watcher thread samples the level register and posts the changes */
+/* through a pipe; only one pin can be watched at a time.                       */
+int gpioEdgeOpen(int pin)
+{
+  if (edgePin >= 0)
+    return -1;
+
+  if (gpioBackend == GPIO_BACKEND_MEM)
+  {
+    struct gpioevent_request req;
+    int chip = open("/dev/gpiochip0", O_RDONLY | O_CLOEXEC);
+
+    memset(&req, 0, sizeof(req));
+    req.lineoffset = pin;
+    req.handleflags = GPIOHANDLE_REQUEST_INPUT;
+    req.eventflags = GPIOEVENT_REQUEST_BOTH_EDGES;
+    strncpy(req.consumer_label, "master-mind", sizeof(req.consumer_label) - 1);
+    if (chip >= 0 && ioctl(chip, GPIO_GET_LINEEVENT_IOCTL, &req) == 0)
+    {
+      close(chip);
+      fcntl(req.fd, F_SETFL, fcntl(req.fd, F_GETFL) | O_NONBLOCK);
+      edgePin = pin;
+      edgeLineFd = req.fd;
+      edgeStampClock = -1;
+      return edgeLineFd;
+    }
+    if (chip >= 0)
+      close(chip);
+    fprintf(stderr, "gpio: no line events for pin %d (%s), sampling its level instead\n", pin, strerror(errno));
+  }
+
+  if (pipe(edgePipe) != 0)
+    return -1;
+  fcntl(edgePipe[0], F_SETFL, O_NONBLOCK);
+  edgeLast = (gpioRegs[GPIO_GPLEV0 + pin / 32] >> (pin % 32)) & 1;
+  edgePin = pin;
+  edgeRunning = 1;
+  if (pthread_create(&edgeThread, NULL, gpioEdgeWatch, NULL) != 0)
+  {
+    edgeRunning = 0;
+    gpioEdgeClose();
+    return -1;
+  }
+  return edgePipe[0];
+}
+
+/* read the next edge from @fd@ into @e@; returns 1 if there was one, 0 if not */
+int gpioEdgeRead(int fd, struct gpioEdge *e)
+{
+  if (fd == edgeLineFd)
+  {
+    struct gpioevent_data ev;
+
+    if (read(fd, &ev, sizeof(ev)) != sizeof(ev))
+      return 0;
+    e->us = gpioEdgeStamp(ev.timestamp);
+    e->pin = edgePin;
+    e->level = ev.id == GPIOEVENT_EVENT_RISING_EDGE;
+    return 1;
+  }
+  return read(fd, e, sizeof(*e)) == sizeof(*e);
+}
+
+void gpioEdgeClose(void)
+{
+  if (edgeRunning)
+  {
+    edgeRunning = 0;
+    pthread_join(edgeThread, NULL);
+  }
+  if (edgeLineFd >= 0)
+    close(edgeLineFd);
+  if (edgePipe[0] >= 0)
+  {
+    close(edgePipe[0]);
+    close(edgePipe[1]);
+  }
+  edgeLineFd = edgePipe[0] = edgePipe[1] = -1;
+  edgePin = -1;
+}
@@ -0,0 +1,68 @@
+/* ***************************************************************************** */
+/* GPIO backends for the low-level hardware control fcts.                        */
+/* The fcts in master-mind.c access the GPIO registers through the pointer they  */
+/* are given; gpioOpen decides what that pointer maps:                           */
+/*   "mem"        the real registers, through /dev/mem (needs root, RPi only)    */
+/*   "anon"       an anonymous, zero-filled register block                       */
+/*   "file:PATH"  a register block shared through the file PATH, so another      */
+/*                process can watch the outputs and drive the inputs             */
+/* With a simulated backend every write to an output pin is also reflected in   */
+/* the pin level register and recorded with a timestamp, so the LCD driver,      */
+/* button input and game loop can be run and profiled on any Linux host.         */
+/* Edges on an input pin come as events on a file descriptor (gpioEdgeOpen), so  */
+/* the program can sleep in poll/epoll until the button changes.                 */
+/* ***************************************************************************** */
+
+#ifndef LCD_BINARY_H
+#define LCD_BINARY_H
+
+#include <stdint.h>
+
+// the GPIO backends
+#define GPIO_BACKEND_MEM 0
+#define GPIO_BACKEND_ANON 1
+#define GPIO_BACKEND_FILE 2
+
+// BCM2835 GPIO register offsets, in 32-bit words from the GPIO base
+#define GPIO_GPFSEL0 0
+#define GPIO_GPSET0 7
+#define GPIO_GPCLR0 10
+#define GPIO_GPLEV0 13
+#define GPIO_GPEDS0 16
+
+// number of GPIO pins of the BCM2835
+#define GPIO_PINS 54
+
+// one recorded pin transition
+struct gpioEvent
+{
+  uint64_t us; // microseconds since gpioOpen
+  uint8_t pin, level;
+};
+
+// one edge on an input pin, as delivered by gpioEdgeRead
+struct gpioEdge
+{
+  uint64_t us; // CLOCK_MONOTONIC timestamp of the edge, in microseconds
+  int pin, level;
+};
+
+// the backend gpio points into; GPIO_BACKEND_MEM until gpioOpen says otherwise
+extern int gpioBackend;
+
+uint32_t *gpioOpen(const char *spec, unsigned int base);
+void gpioClose(void);
+
+void gpioSimWrite(int pin, int value);
+void gpioSimWriteMask(uint32_t set, uint32_t clr);
+void gpioSimSetLevel(int pin, int value);
+
+int gpioEdgeOpen(int pin);
+int gpioEdgeRead(int fd, struct gpioEdge *e);
+void gpioEdgeClose(void);
+uint64_t gpioNowUs(void);
+
+long gpioTransitions(int pin);
+int gpioWriteTrace(const char *path);
+
+#endif
@@ -44,6 +44,18 @@
 #include <sys/stat.h>
 #include <sys/wait.h>
 #include <sys/ioctl.h>
+#include <poll.h>
+#include <sys/timerfd.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+
+#include "lcdBinary.h"
+#include "mm-cands.h"
+#include "mm-codes.h"
+#include "mm-solver.h"
+#include "mm-rng.h"
+#include "mm-sim.h"
+#include "mm-table.h"
 
 /* --------------------------------------------------------------------------- */
 /* Config settings */
@@ -66,11 +78,11 @@
 // delay for loop iterations (mainly), in ms
 // in mili-seconds: 0.2s
 #define DELAY 200
-// in micro-seconds: 3s
-#define TIMEOUT 3000000
+// time the player has to enter one peg, in micro-seconds: 5s
+#define TIMEOUT 5000000
 // =======================================================
 // APP constants   ---------------------------------
-// number of colours and length of the sequence
+// default number of colours and length of the sequence; see options -C and -L
 #define COLS 3
 #define SEQL 3
 // =======================================================
@@ -117,25 +129,37 @@ static unsigned char newChar[8] =
         0b11111,
 };
 
-/* Constants */
-static const int colors = COLS;
-static const int seqlen = SEQL;
+/* Settings of the game, fixed once the command line has been processed */
+static int colors = COLS;
+static int seqlen = SEQL;
 
 static char *color_names[] = {"red", "green", "blue"};
 
-static int *theSeq = NULL;
-
-static int *seq1, *seq2, *cpy1, *cpy2;
+// the secret sequence, packed (see mm-codes.h)
+static seq_t theSeq = 0;
 
 /* --------------------------------------------------------------------------- */
 
+// largest display the shadow framebuffer supports (HD44780: 40x2 or 20x4)
+#define LCD_MAX_ROWS 4
+#define LCD_MAX_COLS 40
+
 // data structure holding data on the representation of the LCD
 struct lcdDataStruct
 {
   int bits, rows, cols;
   int rsPin, strbPin;
   int dataPins[8];
-  int cx, cy;
+  int cx, cy; // cursor position; cx == cols if the display address is past the end of the row
+  // shadow framebuffer: fb is what should be shown, shown what the display shows;
+  // lcdFlush sends only the cells that differ (see the LCD functions section)
+  unsigned char fb[LCD_MAX_ROWS][LCD_MAX_COLS];
+  unsigned char shown[LCD_MAX_ROWS][LCD_MAX_COLS];
+  unsigned long cellsSent, cellsSkipped, moves; // counters for lcdFlush
+  // bus masks (see lcdBusInit): the GPSET0/GPCLR0 words that put nibble v on the
+  // data pins with RS at level rs are busSet[rs][v] and busClr[rs][v]
+  int busFast; // 0 if some LCD pin is not in GPIO bank 0, so the masks can't be used
+  uint32_t busSet[2][16], busClr[2][16], strbMask;
 };
 
 static int lcdControl;
@@ -168,6 +192,9 @@ static int lcdControl;
 
 #define LCD_CDSHIFT_RL 0x04
 
+// DDRAM address of the first character of each row
+static const unsigned char lcdRowOff[LCD_MAX_ROWS] = {0x00, 0x40, 0x14, 0x54};
+
 // Mask for the bottom 64 pins which belong to the Raspberry Pi
 //	The others are available for the other devices
 
@@ -177,10 +204,15 @@ static unsigned int gpiobase;
 static uint32_t *gpio;
 
 static int timed_out = 0;
+// timerfd behind the timers of timerArm, -1 until timerInit
+static int timerFd = -1;
 
 /* ------------------------------------------------------- */
 // misc prototypes
 int failure(int fatal, const char *message, ...);
+void delay(unsigned int howLong);
+void delayMicroseconds(unsigned int howLong);
+void timer_handler(int signum);
 void waitForEnter(void);
 int waitForButton(uint32_t *gpio, int button);
 
@@ -197,6 +229,7 @@ void digitalWrite(uint32_t *gpio, int pin, int value)
 
   uint32_t *gpio_register = gpio + (pin / 32);
 
+#if defined(__arm__)
   if (value)
   {
     // Set pin
@@ -207,15 +240,36 @@ void digitalWrite(uint32_t *gpio, int pin, int value)
     // Clear pin
     asm volatile("str %1, [%0, #0x28]" : : "r"(gpio_register), "r"(pin_mask));
   }
+#else
+  // same stores in C, for hosts without the ARM inline asm (simulated backends)
+  ((volatile uint32_t *)gpio_register)[value ? GPIO_GPSET0 : GPIO_GPCLR0] = pin_mask;
+#endif
+  if (gpioBackend != GPIO_BACKEND_MEM)
+    gpioSimWrite(pin, value);
 }
 
+// cache of the function (mode) we last set for each pin, -1 if unknown; we own
+// the pins we use, so GPFSEL only needs a read-modify-write when the mode changes
+static signed char pinFunc[GPIO_PINS] = {[0 ... GPIO_PINS - 1] = -1};
+static unsigned long pinModeWrites, pinModeSkips;
+
 /* set the @mode@ of a GPIO @pin@ to INPUT or OUTPUT; @gpio@ is the mmaped GPIO base address */
 void pinMode(uint32_t *gpio, int pin, int mode)
 {
-  uint32_t reg = *(gpio + (pin / 10));
+  if (pinFunc[pin] == mode)
+  {
+    pinModeSkips++;
+    return;
+  }
+  pinFunc[pin] = mode;
+  pinModeWrites++;
+
+  volatile uint32_t *fsel = gpio + (pin / 10);
+  uint32_t reg = *fsel;
   int offset = (pin % 10) * 3;
   uint32_t mask = 7 << offset;
 
+#if defined(__arm__)
   asm volatile(
       "bic %[reg], %[mask]"
       : [reg] "+r"(reg)
@@ -226,8 +280,11 @@ void pinMode(uint32_t *gpio, int pin, int mode)
       "orr %[reg], %[mode]"
       : [reg] "+r"(reg)
       : [mode] "r"(mode << offset));
+#else
+  reg = (reg & ~mask) | (mode << offset);
+#endif
 
-  *(gpio + (pin / 10)) = reg;
+  *fsel = reg;
 }
 
 /* send a @value@ (LOW or HIGH) on pin number @pin@; @gpio@ is the mmaped GPIO base address */
@@ -248,6 +305,7 @@ int readButton(uint32_t *gpio, int button)
 
   // Read pin state
   int result;
+#if defined(__arm__)
   asm volatile(
       "ldr r0, [%1, #52] \n"   // Load value from memory address gpio + 13 into r0
       "mov r1, #1 \n"          // Load immediate value 1 into r1
@@ -258,36 +316,197 @@ int readButton(uint32_t *gpio, int button)
       : "r"(gpio), "r"(button) // Input operands
       : "r0", "r1"             // Clobbered registers
   );
+#else
+  result = ((volatile uint32_t *)gpio)[GPIO_GPLEV0] & (1u << button);
+#endif
 
   return (result != 0);
 }
 
-/* wait for a button input on pin number @button@; @gpio@ is the mmaped GPIO base address */
-int waitForButton(uint32_t *gpio, int button)
+/* ======================================================= */
+/* SECTION: button input                                   */
+/* ------------------------------------------------------- */
+/* Button presses arrive as timestamped edge events (see gpioEdgeOpen in      */
+/* lcdBinary.c) and go through a debouncer. The first edge that changes the   */
+/* state is reported at once; edges in the debounce window after it are      */
+/* bounces and ignored. If the level at the end of the window differs from   */
+/* the reported state, that change is reported then.                         */
+
+// default debounce windows after a press and after a release, in us; see option -b
+#define DEBOUNCE_US 20000
+
+// events reported by buttonWait
+#define BUTTON_NONE 0
+#define BUTTON_PRESS 1
+#define BUTTON_RELEASE 2
+
+struct debounceStruct
+{
+  int state, level;      // reported state, and last raw level seen (HIGH = pressed)
+  uint64_t lockUntil;    // end of the current debounce window
+  uint64_t pressUs, releaseUs; // debounce windows after a press and after a release
+  uint64_t eventUs;      // timestamp of the last reported event
+  unsigned long bounces; // edges ignored as bounces
+};
+
+static struct buttonStruct
+{
+  int ready, pin, fd;
+  struct debounceStruct db;
+  unsigned long presses;
+  uint64_t latencySum, latencyMax; // press-to-handled, in us
+} button = {.pin = BUTTON, .fd = -1};
+
+/* report a change of the state at time @t@, if the raw level differs from it */
+static int debounceCommit(struct debounceStruct *d, uint64_t t)
+{
+  if (d->level == d->state)
+    return BUTTON_NONE;
+  d->state = d->level;
+  d->eventUs = t;
+  d->lockUntil = t + (d->state == HIGH ? d->pressUs : d->releaseUs);
+  return d->state == HIGH ? BUTTON_PRESS : BUTTON_RELEASE;
+}
+
+/* feed a raw edge to @level@ at time @t@ into the debouncer */
+static int debounceEdge(struct debounceStruct *d, uint64_t t, int level)
+{
+  d->level = level;
+  if (t < d->lockUntil)
+  {
+    d->bounces++;
+    return BUTTON_NONE;
+  }
+  return debounceCommit(d, t);
+}
+
+/* at time @now@, report a change that happened during an expired debounce window */
+static int debounceTick(struct debounceStruct *d, uint64_t now)
+{
+  if (now < d->lockUntil)
+    return BUTTON_NONE;
+  return debounceCommit(d, d->lockUntil > d->eventUs ? d->lockUntil : now);
+}
+
+/* start listening to the button on pin @pin@, with a debounce window of @windowUs@ */
+void buttonInit(int pin, uint64_t windowUs)
+{
+  button.ready = 1;
+  button.pin = pin;
+  button.fd = gpioEdgeOpen(pin);
+  button.db.state = button.db.level = readButton(gpio, pin);
+  button.db.pressUs = button.db.releaseUs = windowUs;
+  if (button.fd < 0)
+    fprintf(stderr, "button: no edge events, polling pin %d\n", pin);
+}
+
+/* count a reported event, and measure the press-to-handled latency of presses */
+static int buttonHandled(int ev)
+{
+  uint64_t now = gpioNowUs();
+
+  if (ev == BUTTON_PRESS)
+  {
+    button.presses++;
+    button.latencySum += now - button.db.eventUs;
+    if (now - button.db.eventUs > button.latencyMax)
+      button.latencyMax = now - button.db.eventUs;
+  }
+  return ev;
+}
+
+/* drop the edges that arrived while nobody was listening, e.g. between two */
+/* input windows of the game, and take the current level as the state      */
+void buttonFlush(void)
+{
+  struct gpioEdge e;
+
+  if (button.fd >= 0)
+    while (gpioEdgeRead(button.fd, &e))
+      ;
+  button.db.state = button.db.level = readButton(gpio, button.pin);
+  button.db.lockUntil = 0;
+}
+
+/* handle the edges that have arrived, without blocking; returns the next     */
+/* debounced event, or BUTTON_NONE if there is none (yet). In that case      */
+/* *@wakeUs@ is set to the end of a debounce window that may still have to    */
+/* report a change, or to 0                                                   */
+int buttonPoll(uint64_t *wakeUs)
 {
-  // Loop until the button is pressed
-  while (1)
+  struct gpioEdge e;
+  int ev;
+
+  *wakeUs = 0;
+  if (button.fd >= 0)
   {
-    // Read the state of the button
-    int state = readButton(gpio, button);
+    while (gpioEdgeRead(button.fd, &e))
+      if ((ev = debounceEdge(&button.db, e.us, e.level)) != BUTTON_NONE)
+        return buttonHandled(ev);
+  }
+  else if (readButton(gpio, button.pin) != button.db.level)
+  { // no edge events: sample the level, as a last resort
+    if ((ev = debounceEdge(&button.db, gpioNowUs(), !button.db.level)) != BUTTON_NONE)
+      return buttonHandled(ev);
+  }
 
-    // Check if the button is pressed
-    if (state == HIGH)
+  if ((ev = debounceTick(&button.db, gpioNowUs())) != BUTTON_NONE)
+    return buttonHandled(ev);
+  if (button.db.level != button.db.state)
+    *wakeUs = button.db.lockUntil;
+  return BUTTON_NONE;
+}
+
+/* wait up to @timeoutUs@ for the next debounced event of the button; returns */
+/* BUTTON_PRESS, BUTTON_RELEASE, or BUTTON_NONE on a time-out or when a timer  */
+/* (see timerArm) has fired                                                    */
+int buttonWait(uint64_t timeoutUs)
+{
+  struct pollfd pfd[2] = {{button.fd, POLLIN, 0}, {timerFd, POLLIN, 0}};
+  uint64_t now = gpioNowUs(), end = now + timeoutUs, wait, wake;
+  int ev;
+
+  for (;;)
+  {
+    if ((ev = buttonPoll(&wake)) != BUTTON_NONE)
+      return ev;
+    now = gpioNowUs();
+    if (now >= end)
+      return BUTTON_NONE;
+
+    // sleep until the next edge, the time-out, or the end of a debounce window
+    // that may still have to report a change
+    wait = end - now;
+    if (wake != 0 && wake - now < wait)
+      wait = wake - now;
+    if (button.fd >= 0 || timerFd >= 0)
     {
-      fprintf(stderr, "Button pressed\n");
-      break;
+      if (poll(pfd, 2, button.fd >= 0 ? (int)((wait + 999) / 1000) : 1) > 0 && (pfd[1].revents & POLLIN))
+      {
+        timer_handler(0);
+        return BUTTON_NONE;
+      }
     }
-    // Delay for a short period before checking the button state again
     else
+      delayMicroseconds(wait < 1000 ? wait : 1000);
+  }
+}
+
+/* wait up to 100ms for a press of the button on pin number @button@; returns 1 */
+/* if it was pressed, 0 if not; @gpio@ is the mmaped GPIO base address           */
+int waitForButton(uint32_t *gpio, int pin)
+{
+  uint64_t end = gpioNowUs() + 100000, now;
+
+  if (!button.ready)
+    buttonInit(pin, DEBOUNCE_US);
+  while ((now = gpioNowUs()) < end)
+    if (buttonWait(end - now) == BUTTON_PRESS)
     {
-      // state = ON;
-      struct timespec sleeper, dummy;
-      sleeper.tv_sec = 0;
-      sleeper.tv_nsec = 100000000;
-      nanosleep(&sleeper, &dummy);
-      break;
+      fprintf(stderr, "Button pressed\n");
+      return 1;
     }
-  }
+  return 0;
 }
 
 /* ======================================================= */
@@ -301,33 +520,19 @@ int waitForButton(uint32_t *gpio, int button)
 /* ********************************************************** */
 
 /* initialise the secret sequence; by default it should be a random sequence */
+/* drawn from this thread's generator, seeded by option -r or afresh per run  */
 void initSeq()
 {
-  if (theSeq == NULL)
-  {
-    theSeq = (int *)malloc(SEQL * sizeof(int));
-    if (theSeq == NULL)
-    {
-      fprintf(stderr, "Memory allocation for the Sequence failed \n");
-      exit(EXIT_FAILURE);
-    }
-  }
-
-  srand(time(NULL));
-
-  for (int i = 0; i < SEQL; i++)
-  {
-    theSeq[i] = rand() % COLS + 1;
-  }
+  theSeq = rngSecret(rngLocal(), seqlen, colors);
 }
 
 /* display the sequence on the terminal window, using the format from the sample run in the spec */
-void showSeq(int *seq)
+void showSeq(seq_t seq)
 {
   printf("Secret: ");
-  for (int i = 0; i < SEQL; i++)
+  for (int i = 0; i < seqlen; i++)
   {
-    printf("%d ", seq[i]);
+    printf("%d ", getPeg(seq, i));
   }
   printf("\n");
 }
@@ -337,16 +542,18 @@ void showSeq(int *seq)
 
 /* counts how many entries in seq2 match entries in seq1 */
 /* returns exact and approximate matches, encoded in a single value */
+/* this is the reference version on unpacked sequences; the game itself uses */
+/* countMatchesPacked (see mm-codes.c), which works on packed sequences       */
 int countMatches(int *seq1, int *seq2)
 {
   int exactMatches = 0;
   int approximateMatches = 0;
 
-  int seq1Matched[SEQL] = {0};
-  int seq2Matched[SEQL] = {0};
+  int seq1Matched[MAX_SEQL] = {0};
+  int seq2Matched[MAX_SEQL] = {0};
 
   // Count exact matches
-  for (int i = 0; i < SEQL; i++)
+  for (int i = 0; i < seqlen; i++)
   {
     if (seq1[i] == seq2[i])
     {
@@ -357,11 +564,11 @@ int countMatches(int *seq1, int *seq2)
   }
 
   // Count approximate matches
-  for (int i = 0; i < SEQL; i++)
+  for (int i = 0; i < seqlen; i++)
   {
     if (!seq1Matched[i])
     {
-      for (int j = 0; j < SEQL; j++)
+      for (int j = 0; j < seqlen; j++)
       {
         if (!seq2Matched[j] && seq1[i] == seq2[j])
         {
@@ -374,11 +581,11 @@ int countMatches(int *seq1, int *seq2)
     }
   }
 
-  return exactMatches * 10 + approximateMatches;
+  return MATCH_ENCODE(exactMatches, approximateMatches);
 }
 
 /* show the results from calling countMatches on seq1 and seq1 */
-void showMatches(int code, int *seq1, int *seq2, int lcd_format)
+void showMatches(int code, seq_t seq1, seq_t seq2, int lcd_format)
 {
   /* Assuming the sequences are inputted */
   // int encodedMatches = countMatches(seq1, seq2); // exact in tens, approximate in ones
@@ -386,48 +593,32 @@ void showMatches(int code, int *seq1, int *seq2, int lcd_format)
   // int exact = (encodedMatches - approx) / 10;
 
   /* Assuming code is the output of countMatches */
-  int approx = code % 10;
-  int exact = (code - approx) / 10;
+  int approx = MATCH_APPROX(code);
+  int exact = MATCH_EXACT(code);
 
   printf("%d exact\n", exact);
   printf("%d approximate\n", approx);
 }
 
-/* parse an integer value as a list of digits, and put them into @seq@ */
-/* needed for processing command-line with options -s or -u            */
-void readSeq(int *seq, int val)
-{
-
-  if (seq == NULL)
-  {
-    seq = (int *)malloc(SEQL * sizeof(int));
-  }
-
-  int first = val / 100;
-  int second = (val % 100) / 10;
-  int third = (val % 100) % 10;
-
-  seq[0] = first;
-  seq[1] = second;
-  seq[2] = third;
-}
+/* parsing an integer value as a list of digits, needed for processing command-line */
+/* with options -s or -u, is done by parseSeq in mm-codes.c, on packed sequences    */
 
 /* read a guess sequence fron stdin and store the values in arr */
 /* only needed for testing the game logic, without button input */
 int readNum(int max)
 {
-  printf("Enter %d numbers.\n", SEQL);
+  printf("Enter %d numbers.\n", seqlen);
 
-  int inputs[SEQL];
+  int inputs[MAX_SEQL];
   int counter = 0;
   int input;
-  while (counter < SEQL)
+  while (counter < seqlen)
   {
     scanf("%d", &input);
 
-    if (input > COLS || input < 1)
+    if (input > colors || input < 1)
     {
-      printf("Input range is between 1 and %d. Terminating\n", COLS);
+      printf("Input range is between 1 and %d. Terminating\n", colors);
       return 1;
     }
 
@@ -437,6 +628,71 @@ int readNum(int max)
   return 0;
 }
 
+/* -U mode: read pairs of sequences, one pair of digit strings per line, from @in@, */
+/* and write the answers as "<exact> <approximate>", one line per pair, to @out@.   */
+/* Input and output go through large buffers, so that millions of pairs can be      */
+/* scored by one process; invalid lines give "invalid" and a message on stderr.     */
+/* Returns the number of invalid lines.                                             */
+#define STREAM_BUFSIZE (1 << 16)
+
+static long streamMatches(FILE *in, FILE *out)
+{
+  static char inBuf[STREAM_BUFSIZE], outBuf[STREAM_BUFSIZE];
+  char *line = NULL, *p;
+  size_t cap = 0, pos = 0;
+  long lineNo = 0, bad = 0;
+  seq_t seq[2];
+  int i, k, code;
+
+  setvbuf(in, inBuf, _IOFBF, sizeof(inBuf));
+  while (getline(&line, &cap, in) != -1)
+  {
+    lineNo++;
+    // skip empty lines; anything else gets an answer, so that the answers stay
+    // in step with the input lines
+    for (p = line; *p == ' ' || *p == '\t' || *p == '\r' || *p == '\n'; p++)
+      ;
+    if (*p == '\0')
+      continue;
+    for (k = 0; k < 2; k++)
+    {
+      while (*p == ' ' || *p == '\t')
+        p++;
+      seq[k] = 0;
+      for (i = 0; i < seqlen && *p >= '1' && *p <= '0' + colors; i++, p++)
+        seq[k] = setPeg(seq[k], i, *p - '0');
+      if (i < seqlen || (*p != ' ' && *p != '\t' && *p != '\r' && *p != '\n' && *p != '\0'))
+        break;
+    }
+    while (*p == ' ' || *p == '\t' || *p == '\r' || *p == '\n')
+      p++;
+
+    if (pos > sizeof(outBuf) - 16)
+    {
+      fwrite(outBuf, 1, pos, out);
+      pos = 0;
+    }
+    if (k < 2 || *p != '\0')
+    {
+      fprintf(stderr, "line %ld: expected two sequences of %d digits between 1 and %d\n", lineNo, seqlen, colors);
+      memcpy(outBuf + pos, "invalid\n", 8);
+      pos += 8;
+      bad++;
+      continue;
+    }
+    // both counts are single digits, since MAX_SEQL < 10
+    code = countMatchesPacked(seq[0], seq[1]);
+    outBuf[pos++] = '0' + MATCH_EXACT(code);
+    outBuf[pos++] = ' ';
+    outBuf[pos++] = '0' + MATCH_APPROX(code);
+    outBuf[pos++] = '\n';
+  }
+  fwrite(outBuf, 1, pos, out);
+  fflush(out);
+  free(line);
+  return bad;
+}
+
 /* ======================================================= */
 /* SECTION: TIMER code                                     */
 /* ------------------------------------------------------- */
@@ -446,21 +702,274 @@ int readNum(int max)
 static uint64_t startT, stopT;
 
 /* you may need this function in timer_handler() below  */
-/* use the libc fct gettimeofday() to implement it      */
+/* CLOCK_MONOTONIC, so that timers are not upset by changes of the wall clock, */
+/* and on the same clock as the timerfd and the button edge timestamps         */
 uint64_t timeInMicroseconds()
 {
-  struct timeval currentTime;
-  gettimeofday(&currentTime, NULL);
-  uint64_t microseconds = (uint64_t)currentTime.tv_sec * 1000000 + (uint64_t)currentTime.tv_usec;
+  struct timespec currentTime;
+  clock_gettime(CLOCK_MONOTONIC, &currentTime);
+  uint64_t microseconds = (uint64_t)currentTime.tv_sec * 1000000 + (uint64_t)currentTime.tv_nsec / 1000;
 
   return microseconds;
 }
 
+/*
+ * timerInit: timerArm: timerCancel: timer_handler:
+ *	A small set of one-shot and periodic timers, on one timerfd. The timerfd is
+ *	always armed, with an absolute CLOCK_MONOTONIC time, for the earliest timer
+ *	due; it becomes readable when that time has come, and timer_handler then
+ *	calls the callbacks of all timers that are due. Whoever waits for input
+ *	(poll/epoll) waits on timerFd as well, so there are no busy loops.
+ *********************************************************************************
+ */
+
+// most timers that can be armed at the same time
+#define TIMER_MAX 8
+
+typedef void (*timerFn)(int id);
+
+static struct timerStruct
+{
+  int active;
+  uint64_t due, period; // in us; period 0 for a one-shot timer
+  timerFn fn;
+} timers[TIMER_MAX];
+
+static unsigned long timerFired;
+static uint64_t timerLateSum, timerLateMax; // how late callbacks ran, in us
+
+/* (re)arm the timerfd for the earliest active timer, or disarm it */
+static void timerRearm(void)
+{
+  struct itimerspec its;
+  uint64_t due = 0;
+  int i;
+
+  for (i = 0; i < TIMER_MAX; i++)
+    if (timers[i].active && (due == 0 || timers[i].due < due))
+      due = timers[i].due;
+  // due is on the monotonic clock, so it is never 0 for an active timer;
+  // an all-zero it_value disarms the timerfd
+  memset(&its, 0, sizeof(its));
+  its.it_value.tv_sec = due / 1000000;
+  its.it_value.tv_nsec = (long)(due % 1000000) * 1000;
+  timerfd_settime(timerFd, TFD_TIMER_ABSTIME, &its, NULL);
+}
+
+/* create the timerfd; returns it, or -1 */
+int timerInit(void)
+{
+  if (timerFd < 0)
+    timerFd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+  return timerFd;
+}
+
+/* call @fn@ in @delayUs@ microseconds, and then every @periodUs@ microseconds */
+/* unless that is 0; returns the id of the timer, or -1 if all are in use    */
+int timerArm(uint64_t delayUs, uint64_t periodUs, timerFn fn)
+{
+  int i;
+
+  for (i = 0; i < TIMER_MAX; i++)
+    if (!timers[i].active)
+    {
+      timers[i].active = 1;
+      timers[i].due = timeInMicroseconds() + delayUs;
+      timers[i].period = periodUs;
+      timers[i].fn = fn;
+      timerRearm();
+      return i;
+    }
+  return -1;
+}
+
+void timerCancel(int id)
+{
+  if (id >= 0 && id < TIMER_MAX && timers[id].active)
+  {
+    timers[id].active = 0;
+    timerRearm();
+  }
+}
+
 /* this should be the callback, triggered via an interval timer, */
 /* that is set-up through a call to sigaction() in the main fct. */
+/* Here the interval timer is the timerfd: call timer_handler when it is readable */
 void timer_handler(int signum)
 {
-  uint64_t time = timeInMicroseconds();
+  uint64_t time = timeInMicroseconds(), expirations;
+  int i;
+
+  (void)signum;
+  if (read(timerFd, &expirations, sizeof(expirations)) < 0 && errno != EAGAIN)
+    return;
+  for (i = 0; i < TIMER_MAX; i++)
+    if (timers[i].active && timers[i].due <= time)
+    {
+      timerFired++;
+      timerLateSum += time - timers[i].due;
+      if (time - timers[i].due > timerLateMax)
+        timerLateMax = time - timers[i].due;
+      if (timers[i].period > 0)
+        while (timers[i].due <= time) // skip missed ticks rather than firing them in a burst
+          timers[i].due += timers[i].period;
+      else
+        timers[i].active = 0;
+      timers[i].fn(i);
+    }
+  timerRearm();
+}
+
+/* a timer callback for the turn time-out */
+static void turnTimeout(int id)
+{
+  (void)id;
+  timed_out = 1;
+}
+
+/* ======================================================= */
+/* SECTION: LED patterns                                   */
+/* ------------------------------------------------------- */
+/* Each LED has a queue of patterns: off or solid for some time, or blink   */
+/* n times at some period. ledTick advances them all from one periodic      */
+/* timer, which only runs while some pattern is in progress. Nobody sleeps, */
+/* and several LEDs can animate at once. Patterns are timed from the start  */
+/* of their step, not from the last tick, so they do not drift.             */
+
+// period of the LED timer, while a pattern is in progress, in us
+#define LED_TICK_US 10000
+// LEDs that can be driven, and patterns that can be queued per LED
+#define LED_SLOTS 4
+#define LED_STEPS 16
+
+// kinds of patterns
+#define LED_OFF 0
+#define LED_SOLID 1
+#define LED_BLINK 2
+
+struct ledStep
+{
+  int kind, count;
+  uint64_t us; // how long for LED_OFF/LED_SOLID (0: just set the level), period for LED_BLINK
+};
+
+static struct ledStruct
+{
+  int pin, level; // level is -1 until the first write
+  struct ledStep steps[LED_STEPS];
+  int head, n;
+  uint64_t start; // when the current step started
+} leds[LED_SLOTS] = {[0 ... LED_SLOTS - 1] = {.pin = -1, .level = -1}};
+
+static int ledTimer = -1;
+static unsigned long ledTicks, ledWrites;
+
+static void ledSet(struct ledStruct *l, int level)
+{
+  if (l->level == level)
+    return;
+  digitalWrite(gpio, l->pin, level);
+  l->level = level;
+  ledWrites++;
+}
+
+/* bring @l@ up to date at time @now@; returns 1 if a step is still in progress */
+static int ledAdvance(struct ledStruct *l, uint64_t now)
+{
+  while (l->n > 0)
+  {
+    struct ledStep *st = &l->steps[l->head];
+    uint64_t elapsed = now - l->start, total = st->kind == LED_BLINK ? st->count * st->us : st->us;
+
+    if (elapsed < total)
+    {
+      // on for the first half of each period of a blink
+      ledSet(l, st->kind == LED_BLINK ? (elapsed % st->us) < st->us / 2 : st->kind == LED_SOLID);
+      return 1;
+    }
+    // a step of no duration just sets the level; at the end of the last timed
+    // step the LED goes off
+    l->start += total;
+    l->head = (l->head + 1) % LED_STEPS;
+    l->n--;
+    if (total == 0)
+      ledSet(l, st->kind == LED_SOLID);
+    else if (l->n == 0)
+      ledSet(l, LOW);
+  }
+  return 0;
+}
+
+static void ledTick(int id)
+{
+  uint64_t now = timeInMicroseconds();
+  int i, busy = 0;
+
+  ledTicks++;
+  for (i = 0; i < LED_SLOTS; i++)
+    if (leds[i].pin >= 0)
+      busy |= ledAdvance(&leds[i], now);
+  if (!busy)
+  {
+    timerCancel(id);
+    ledTimer = -1;
+  }
+}
+
+/* queue a pattern for the LED on pin @pin@; returns 0, or -1 if its queue is full */
+static int ledPush(int pin, int kind, int count, uint64_t us)
+{
+  struct ledStruct *l = NULL;
+  int i;
+
+  for (i = 0; i < LED_SLOTS && l == NULL; i++)
+    if (leds[i].pin == pin)
+      l = &leds[i];
+  for (i = 0; i < LED_SLOTS && l == NULL; i++)
+    if (leds[i].pin < 0)
+    {
+      l = &leds[i];
+      l->pin = pin;
+    }
+  if (l == NULL || l->n == LED_STEPS)
+    return -1;
+
+  l->steps[(l->head + l->n++) % LED_STEPS] = (struct ledStep){kind, count, us};
+  // an idle LED starts the pattern at once
+  if (l->n == 1)
+    l->start = timeInMicroseconds();
+  if (ledAdvance(l, timeInMicroseconds()) && ledTimer < 0)
+    ledTimer = timerArm(LED_TICK_US, LED_TICK_US, ledTick);
+  return 0;
+}
+
+/* blink the LED on pin @pin@ @n@ times, once every @periodUs@ */
+int ledBlink(int pin, int n, uint64_t periodUs)
+{
+  return n > 0 ? ledPush(pin, LED_BLINK, n, periodUs) : 0;
+}
+
+/* turn the LED on pin @pin@ on, or off, for @us@; with @us@ 0, turn it on or */
+/* off, until the next pattern                                                  */
+int ledSolid(int pin, uint64_t us)
+{
+  return ledPush(pin, LED_SOLID, 1, us);
+}
+
+int ledOff(int pin, uint64_t us)
+{
+  return ledPush(pin, LED_OFF, 1, us);
+}
+
+/* 1 if some LED is still in a pattern */
+int ledBusy(void)
+{
+  int i;
+
+  for (i = 0; i < LED_SLOTS; i++)
+    if (leds[i].pin >= 0 && leds[i].n > 0)
+      return 1;
+  return 0;
 }
 
 /* ======================================================= */
@@ -511,30 +1020,161 @@ void delay(unsigned int howLong)
   nanosleep(&sleeper, &dummy);
 }
 
+/*
+ * delayMicrosecondsHard: delayCalibrate: delayMicroseconds:
+ *	Short waits, like the 50us in strobe, are far shorter than the time the
+ *	kernel takes to wake up a sleeping process, so nanosleep would overshoot
+ *	them many times over. They spin on CLOCK_MONOTONIC instead. Longer waits
+ *	sleep for all but the calibrated wake-up latency, and spin for the rest.
+ *	Requested and actually spent time are counted, see delayReport.
+ *********************************************************************************
+ */
+
+// never sleep for waits shorter than this, whatever the calibration says
+#define DELAY_SPIN_MIN 100
+// ... and always sleep for waits longer than this, so that a calibration run hit by
+// preemption cannot make every LCD delay spin a core
+#define DELAY_SPIN_MAX 1000
+// number of nanosleep calls used to measure the wake-up latency
+#define DELAY_CALIBRATE_RUNS 16
+
+static unsigned int delaySleepSlack = DELAY_SPIN_MIN; // wake-up latency of nanosleep, in us
+static uint64_t delayCalls, delaySpins, delayRequested, delaySpent;
+
+static inline uint64_t delayNowNs(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+/* spin until @howLong@ microseconds after @start@ (a delayNowNs timestamp) */
+static void delayMicrosecondsHard(uint64_t start, unsigned int howLong)
+{
+  uint64_t end = start + (uint64_t)howLong * 1000;
+
+  while (delayNowNs() < end)
+    ;
+}
+
+/* measure how late nanosleep returns from a 1us sleep, as the median of some */
+/* runs, so that one preempted run does not count; waits up to this long are   */
+/* spun, longer ones sleep for all but this and spin the rest                  */
+void delayCalibrate(void)
+{
+  struct timespec sleeper = {0, 1000};
+  uint64_t t0, late[DELAY_CALIBRATE_RUNS];
+  int i, j;
+
+  for (i = 0; i < DELAY_CALIBRATE_RUNS; i++)
+  {
+    t0 = delayNowNs();
+    nanosleep(&sleeper, NULL);
+    late[i] = delayNowNs() - t0;
+    for (j = i; j > 0 && late[j - 1] > late[j]; j--) // insertion sort, to find the median
+    {
+      t0 = late[j];
+      late[j] = late[j - 1];
+      late[j - 1] = t0;
+    }
+  }
+  delaySleepSlack = (unsigned int)(late[DELAY_CALIBRATE_RUNS / 2] / 1000) + 1;
+  if (delaySleepSlack < DELAY_SPIN_MIN)
+    delaySleepSlack = DELAY_SPIN_MIN;
+  else if (delaySleepSlack > DELAY_SPIN_MAX)
+    delaySleepSlack = DELAY_SPIN_MAX;
+}
+
 void delayMicroseconds(unsigned int howLong)
 {
   struct timespec sleeper;
-  unsigned int uSecs = howLong % 1000000;
-  unsigned int wSecs = howLong / 1000000;
+  uint64_t start = delayNowNs();
 
-  /**/ if (howLong == 0)
+  if (howLong == 0)
     return;
-#if 0
-  else if (howLong  < 100)
-    delayMicrosecondsHard (howLong) ;
-#endif
+  else if (howLong <= delaySleepSlack)
+  {
+    delayMicrosecondsHard(start, howLong);
+    delaySpins++;
+  }
   else
   {
-    sleeper.tv_sec = wSecs;
-    sleeper.tv_nsec = (long)(uSecs * 1000L);
+    unsigned int sleep = howLong - delaySleepSlack;
+    sleeper.tv_sec = sleep / 1000000;
+    sleeper.tv_nsec = (long)(sleep % 1000000) * 1000L;
     nanosleep(&sleeper, NULL);
+    delayMicrosecondsHard(start, howLong);
   }
+  delayCalls++;
+  delayRequested += howLong;
+  delaySpent += (delayNowNs() - start) / 1000;
+}
+
+/* print the time requested from, and actually spent in, delayMicroseconds */
+void delayReport(FILE *f)
+{
+  fprintf(f, "delayMicroseconds: %llu calls (%llu spun), %llu us requested, %llu us spent (%+.1f%%), slack %u us\n",
+          (unsigned long long)delayCalls, (unsigned long long)delaySpins,
+          (unsigned long long)delayRequested, (unsigned long long)delaySpent,
+          delayRequested ? 100.0 * ((double)delaySpent - delayRequested) / delayRequested : 0.0, delaySleepSlack);
 }
 
 /* ======================================================= */
 /* SECTION: LCD functions                                  */
 /* ------------------------------------------------------- */
 /* medium-level interface functions (all in C) */
+
+/*
+ * lcdBusInit: lcdBusStore:
+ *	Precompute, from dataPins[], rsPin and strbPin, the GPSET0/GPCLR0 words for
+ *	all 16 nibble values with RS low and high, and for the strobe. All pins must
+ *	be in GPIO bank 0 (pins 0..31); otherwise busFast stays 0 and the LCD
+ *	functions fall back to one digitalWrite per pin.
+ *********************************************************************************
+ */
+void lcdBusInit(struct lcdDataStruct *lcd)
+{
+  int i, rs, v;
+
+  lcd->busFast = 0;
+  if (lcd->bits != 4 || lcd->rsPin >= 32 || lcd->strbPin >= 32)
+    return;
+  for (i = 0; i < 4; i++)
+    if (lcd->dataPins[i] >= 32)
+      return;
+
+  for (rs = 0; rs < 2; rs++)
+    for (v = 0; v < 16; v++)
+    {
+      lcd->busSet[rs][v] = rs ? 1u << lcd->rsPin : 0;
+      lcd->busClr[rs][v] = rs ? 0 : 1u << lcd->rsPin;
+      for (i = 0; i < 4; i++)
+        if (v & (1 << i))
+          lcd->busSet[rs][v] |= 1u << lcd->dataPins[i];
+        else
+          lcd->busClr[rs][v] |= 1u << lcd->dataPins[i];
+    }
+  lcd->strbMask = 1u << lcd->strbPin;
+  lcd->busFast = 1;
+}
+
+/* set the pins in @set@ and clear the pins in @clr@, all in bank 0, with one store each */
+static inline void lcdBusStore(uint32_t set, uint32_t clr)
+{
+#if defined(__arm__)
+  asm volatile("str %1, [%0, #0x1C] \n" // GPSET0
+               "str %2, [%0, #0x28] \n" // GPCLR0
+               :
+               : "r"(gpio), "r"(set), "r"(clr)
+               : "memory");
+#else
+  ((volatile uint32_t *)gpio)[GPIO_GPSET0] = set;
+  ((volatile uint32_t *)gpio)[GPIO_GPCLR0] = clr;
+#endif
+  if (gpioBackend != GPIO_BACKEND_MEM)
+    gpioSimWriteMask(set, clr);
+}
+
 /* from wiringPi:
  * strobe:
  *	Toggle the strobe (Really the "E") pin to the device.
@@ -545,9 +1185,15 @@ void strobe(const struct lcdDataStruct *lcd)
 {
 
   // Note timing changes for new version of delayMicroseconds ()
-  digitalWrite(gpio, lcd->strbPin, 1);
+  if (lcd->busFast)
+    lcdBusStore(lcd->strbMask, 0);
+  else
+    digitalWrite(gpio, lcd->strbPin, 1);
   delayMicroseconds(50);
-  digitalWrite(gpio, lcd->strbPin, 0);
+  if (lcd->busFast)
+    lcdBusStore(0, lcd->strbMask);
+  else
+    digitalWrite(gpio, lcd->strbPin, 0);
   delayMicroseconds(50);
 }
 
@@ -579,15 +1225,239 @@ void sendDataCmd(const struct lcdDataStruct *lcd, unsigned char data)
       d4 >>= 1;
     }
   }
-  else
+  else
+  {
+    for (i = 0; i < 8; ++i)
+    {
+      digitalWrite(gpio, lcd->dataPins[i], (myData & 1));
+      myData >>= 1;
+    }
+  }
+  strobe(lcd);
+}
+
+/*
+ * lcdSend:
+ *	Send a byte to the display, as a command (@rs@ == 0) or as data (@rs@ == 1).
+ *	On the 4-bit bus each nibble, together with RS, goes out as one GPSET0 and
+ *	one GPCLR0 store, instead of a digitalWrite per pin.
+ *********************************************************************************
+ */
+void lcdSend(const struct lcdDataStruct *lcd, int rs, unsigned char data)
+{
+  if (lcd->bits == 4 && lcd->busFast)
+  {
+    lcdBusStore(lcd->busSet[rs][data >> 4], lcd->busClr[rs][data >> 4]);
+    strobe(lcd);
+    lcdBusStore(lcd->busSet[rs][data & 0x0F], lcd->busClr[rs][data & 0x0F]);
+    strobe(lcd);
+  }
+  else
+  {
+    digitalWrite(gpio, lcd->rsPin, rs);
+    sendDataCmd(lcd, data);
+  }
+}
+
+/*
+ * lcdWriterStart: lcdWriterStop: lcdWrite:
+ *	Asynchronous writer. Once lcdWriterStart has run, lcdWrite does not send a
+ *	byte to the display, with the delays that takes, but pushes it into a
+ *	single-producer/single-consumer ring and returns at once. A writer thread
+ *	drains the ring. The game thread is the only producer, the writer the only
+ *	consumer; each index has one writer, so no locks are needed. An idle writer
+ *	sleeps on an eventfd, which the producer only signals when it has to.
+ *	The ring is not all that is shared: the writer drives the LCD pins while
+ *	the game thread drives the LEDs, in the same GPIO bank. The hardware sets
+ *	and clears pins through GPSET/GPCLR, without a read-modify-write; the
+ *	simulated backends update their level word atomically (see gpioSimWrite).
+ *	With a backlog the writer drops commands that leave no trace: a cursor move
+ *	or display control followed by another one, a move to where the cursor
+ *	already is, or a home right after a clear.
+ *********************************************************************************
+ */
+
+// entries in the ring; a power of 2, and many screens' worth
+#define LCD_RING 1024
+
+struct lcdOp
+{
+  uint64_t us; // when it was queued
+  unsigned char rs, data;
+};
+
+static struct lcdWriterStruct
+{
+  const struct lcdDataStruct *lcd;
+  pthread_t thread;
+  int running, efd;
+  unsigned head, tail; // consumer and producer index, modulo 2^32
+  int sleeping, stop;  // set by the writer before it sleeps, and by lcdWriterStop
+  struct lcdOp ring[LCD_RING];
+  int addr, lastCmd; // writer side: DDRAM address (-1 if unknown), and the previous command
+  unsigned long queued, sent, merged, stalls;
+  unsigned depthMax;
+  uint64_t depthSum, latencySum, latencyMax;
+} lcdWriter = {.efd = -1};
+
+/* 1 if sending command @op@ is pointless, given the writer's state and, if @next@ */
+/* is not NULL, the command queued after it                                      */
+static int lcdRedundant(const struct lcdWriterStruct *w, const struct lcdOp *op, const struct lcdOp *next)
+{
+  if (op->rs != 0)
+    return 0;
+  if ((op->data & LCD_DGRAM) && ((op->data & 0x7F) == w->addr || (next != NULL && next->rs == 0 && (next->data & LCD_DGRAM))))
+    return 1;
+  if ((op->data & 0xF8) == LCD_CTRL && next != NULL && next->rs == 0 && (next->data & 0xF8) == LCD_CTRL)
+    return 1;
+  return (op->data & 0xFE) == LCD_HOME && w->lastCmd == LCD_CLEAR;
+}
+
+/* send @op@ and track what it does to the DDRAM address */
+static void lcdWriterSend(struct lcdWriterStruct *w, const struct lcdOp *op)
+{
+  lcdSend(w->lcd, op->rs, op->data);
+  if (op->rs)
+  {
+    // the address wraps from the end of the first line of DDRAM to the second, and back
+    if (w->addr >= 0)
+      w->addr = w->addr == 0x27 ? 0x40 : w->addr == 0x67 ? 0x00 : w->addr + 1;
+    w->lastCmd = -1;
+    return;
+  }
+  delay(2);
+  if (op->data == LCD_CLEAR || (op->data & 0xFE) == LCD_HOME)
+  {
+    delay(5);
+    w->addr = 0;
+  }
+  else if (op->data & LCD_DGRAM)
+    w->addr = op->data & 0x7F;
+  else if ((op->data & 0xF8) != LCD_CTRL)
+    w->addr = -1;
+  w->lastCmd = op->data;
+}
+
+static void *lcdWriterMain(void *arg)
+{
+  struct lcdWriterStruct *w = (struct lcdWriterStruct *)arg;
+  unsigned head = w->head, tail;
+  uint64_t v, now;
+
+  for (;;)
+  {
+    tail = __atomic_load_n(&w->tail, __ATOMIC_ACQUIRE);
+    if (head == tail)
+    {
+      if (__atomic_load_n(&w->stop, __ATOMIC_ACQUIRE))
+        break;
+      // announce the sleep, then look again: the producer stores tail before it
+      // loads sleeping, so one of the two sees the other
+      __atomic_store_n(&w->sleeping, 1, __ATOMIC_SEQ_CST);
+      if (__atomic_load_n(&w->tail, __ATOMIC_SEQ_CST) == head && !__atomic_load_n(&w->stop, __ATOMIC_SEQ_CST))
+        (void)read(w->efd, &v, sizeof(v));
+      __atomic_store_n(&w->sleeping, 0, __ATOMIC_RELAXED);
+      continue;
+    }
+
+    struct lcdOp *op = &w->ring[head & (LCD_RING - 1)];
+    if (lcdRedundant(w, op, head + 1 != tail ? &w->ring[(head + 1) & (LCD_RING - 1)] : NULL))
+      w->merged++;
+    else
+    {
+      lcdWriterSend(w, op);
+      w->sent++;
+    }
+    now = gpioNowUs();
+    w->latencySum += now - op->us;
+    if (now - op->us > w->latencyMax)
+      w->latencyMax = now - op->us;
+    __atomic_store_n(&w->head, ++head, __ATOMIC_RELEASE);
+  }
+  return NULL;
+}
+
+/* from now on, write to the display @lcd@ through the writer thread; returns */
+/* 0, or -1 if the thread could not be started and writes stay synchronous    */
+int lcdWriterStart(const struct lcdDataStruct *lcd)
+{
+  struct lcdWriterStruct *w = &lcdWriter;
+
+  w->lcd = lcd;
+  w->addr = w->lastCmd = -1;
+  w->efd = eventfd(0, EFD_CLOEXEC);
+  if (w->efd < 0)
+    return -1;
+  if (pthread_create(&w->thread, NULL, lcdWriterMain, w) != 0)
+  {
+    close(w->efd);
+    w->efd = -1;
+    return -1;
+  }
+  w->running = 1;
+  return 0;
+}
+
+/* wait until the writer has sent everything queued, and stop it */
+void lcdWriterStop(void)
+{
+  struct lcdWriterStruct *w = &lcdWriter;
+  uint64_t v = 1;
+
+  if (!w->running)
+    return;
+  __atomic_store_n(&w->stop, 1, __ATOMIC_SEQ_CST);
+  (void)write(w->efd, &v, sizeof(v));
+  pthread_join(w->thread, NULL);
+  close(w->efd);
+  w->efd = -1;
+  w->running = 0;
+}
+
+/* push a byte for the writer thread; waits, but only if the ring is full */
+static void lcdQueue(int rs, unsigned char data)
+{
+  struct lcdWriterStruct *w = &lcdWriter;
+  unsigned tail = w->tail, depth;
+  uint64_t v = 1;
+
+  while ((depth = tail - __atomic_load_n(&w->head, __ATOMIC_ACQUIRE)) == LCD_RING)
+  {
+    w->stalls++;
+    usleep(100);
+  }
+  w->queued++;
+  w->depthSum += depth + 1;
+  if (depth + 1 > w->depthMax)
+    w->depthMax = depth + 1;
+  w->ring[tail & (LCD_RING - 1)] = (struct lcdOp){gpioNowUs(), (unsigned char)rs, data};
+  __atomic_store_n(&w->tail, tail + 1, __ATOMIC_SEQ_CST);
+  if (__atomic_load_n(&w->sleeping, __ATOMIC_SEQ_CST))
+    (void)write(w->efd, &v, sizeof(v));
+}
+
+/* send a command (@rs@ == 0) or data byte to the display, or queue it for the */
+/* writer thread if that runs                                                  */
+void lcdWrite(const struct lcdDataStruct *lcd, int rs, unsigned char data)
+{
+  if (lcdWriter.running)
   {
-    for (i = 0; i < 8; ++i)
-    {
-      digitalWrite(gpio, lcd->dataPins[i], (myData & 1));
-      myData >>= 1;
-    }
+    lcdQueue(rs, data);
+    return;
   }
-  strobe(lcd);
+  lcdSend(lcd, rs, data);
+  if (rs == 0)
+    delay(2);
+}
+
+void lcdWriterReport(FILE *f)
+{
+  struct lcdWriterStruct *w = &lcdWriter;
+
+  fprintf(f, "LCD writer: %lu bytes queued, %lu sent, %lu coalesced, queue depth %.1f on average, %u at most, "
+             "drain latency %.1f us on average, %llu us at most, %lu stalls on a full ring\n",
+          w->queued, w->sent, w->merged, w->queued ? (double)w->depthSum / w->queued : 0.0, w->depthMax,
+          w->queued ? (double)w->latencySum / w->queued : 0.0, (unsigned long long)w->latencyMax, w->stalls);
 }
 
 /*
@@ -600,9 +1470,7 @@ void lcdPutCommand(const struct lcdDataStruct *lcd, unsigned char command)
 #ifdef DEBUG
   fprintf(stderr, "lcdPutCommand: digitalWrite(%d,%d) and sendDataCmd(%d,%d)\n", lcd->rsPin, 0, lcd, command);
 #endif
-  digitalWrite(gpio, lcd->rsPin, 0);
-  sendDataCmd(lcd, command);
-  delay(2);
+  lcdWrite(lcd, 0, command);
 }
 
 void lcdPut4Command(const struct lcdDataStruct *lcd, unsigned char command)
@@ -610,6 +1478,13 @@ void lcdPut4Command(const struct lcdDataStruct *lcd, unsigned char command)
   register unsigned char myCommand = command;
   register unsigned char i;
 
+  if (lcd->busFast)
+  {
+    lcdBusStore(lcd->busSet[0][command & 0x0F], lcd->busClr[0][command & 0x0F]);
+    strobe(lcd);
+    return;
+  }
+
   digitalWrite(gpio, lcd->rsPin, 0);
 
   for (i = 0; i < 4; ++i)
@@ -632,7 +1507,8 @@ void lcdHome(struct lcdDataStruct *lcd)
 #endif
   lcdPutCommand(lcd, LCD_HOME);
   lcd->cx = lcd->cy = 0;
-  delay(5);
+  if (!lcdWriter.running)
+    delay(5);
 }
 
 void lcdClear(struct lcdDataStruct *lcd)
@@ -643,7 +1519,9 @@ void lcdClear(struct lcdDataStruct *lcd)
   lcdPutCommand(lcd, LCD_CLEAR);
   lcdPutCommand(lcd, LCD_HOME);
   lcd->cx = lcd->cy = 0;
-  delay(5);
+  memset(lcd->shown, ' ', sizeof(lcd->shown));
+  if (!lcdWriter.running)
+    delay(5);
 }
 
 /*
@@ -658,10 +1536,10 @@ void lcdPosition(struct lcdDataStruct *lcd, int x, int y)
 
   if ((x > lcd->cols) || (x < 0))
     return;
-  if ((y > lcd->rows) || (y < 0))
+  if ((y >= lcd->rows) || (y < 0))
     return;
 
-  lcdPutCommand(lcd, x + (LCD_DGRAM | (y > 0 ? 0x40 : 0x00) /* rowOff [y] */));
+  lcdPutCommand(lcd, x + (LCD_DGRAM | lcdRowOff[y]));
 
   lcd->cx = x;
   lcd->cy = y;
@@ -710,8 +1588,12 @@ void lcdCursorBlink(struct lcdDataStruct *lcd, int state)
  */
 void lcdPutchar(struct lcdDataStruct *lcd, unsigned char data)
 {
-  digitalWrite(gpio, lcd->rsPin, 1);
-  sendDataCmd(lcd, data);
+  // lcdFlush may leave the cursor past the last column (cx == cols): wrap first
+  if (lcd->cx >= lcd->cols)
+    lcdPosition(lcd, 0, lcd->cy + 1 == lcd->rows ? 0 : lcd->cy + 1);
+
+  lcdWrite(lcd, 1, data);
+  lcd->shown[lcd->cy][lcd->cx] = data;
 
   if (++lcd->cx == lcd->cols)
   {
@@ -719,8 +1601,7 @@ void lcdPutchar(struct lcdDataStruct *lcd, unsigned char data)
     if (++lcd->cy == lcd->rows)
       lcd->cy = 0;
 
-    // TODO: inline computation of address and eliminate rowOff
-    lcdPutCommand(lcd, lcd->cx + (LCD_DGRAM | (lcd->cy > 0 ? 0x40 : 0x00) /* rowOff [lcd->cy] */));
+    lcdPutCommand(lcd, lcd->cx + (LCD_DGRAM | lcdRowOff[lcd->cy]));
   }
 }
 
@@ -735,22 +1616,535 @@ void lcdPuts(struct lcdDataStruct *lcd, const char *string)
     lcdPutchar(lcd, *string++);
 }
 
+/*
+ * lcdFbClear: lcdFbPuts: lcdFlush: lcdShow:
+ *	Shadow framebuffer. lcdFbClear and lcdFbPuts only change lcd->fb; lcdFlush
+ *	then sends the cells that differ from what the display shows (lcd->shown),
+ *	moving the cursor only where that is cheaper than rewriting unchanged cells.
+ *	No LCD_CLEAR is needed, so a redraw costs a few data writes, not milliseconds.
+ *********************************************************************************
+ */
+
+// rewriting up to this many unchanged cells is cheaper than a cursor move, which
+// is a command byte followed by lcdPutCommand's delay
+#define LCD_FB_GAP 4
+
+void lcdFbClear(struct lcdDataStruct *lcd)
+{
+  memset(lcd->fb, ' ', sizeof(lcd->fb));
+}
+
+/* put @string@ into the framebuffer at column @x@ of row @y@, clipped to the row */
+void lcdFbPuts(struct lcdDataStruct *lcd, int x, int y, const char *string)
+{
+  if (y < 0 || y >= lcd->rows)
+    return;
+  for (; *string && x < lcd->cols; x++, string++)
+    if (x >= 0)
+      lcd->fb[y][x] = *string;
+}
+
+void lcdFlush(struct lcdDataStruct *lcd)
+{
+  int x, y, last;
+
+  for (y = 0; y < lcd->rows; y++)
+  {
+    // last dirty cell in this row, or -1
+    for (last = lcd->cols - 1; last >= 0 && lcd->fb[y][last] == lcd->shown[y][last]; last--)
+      ;
+    for (x = 0; x <= last; x++)
+    {
+      if (lcd->fb[y][x] == lcd->shown[y][x])
+      {
+        lcd->cellsSkipped++;
+        continue;
+      }
+      // bridge short runs of clean cells by rewriting them, otherwise move the cursor
+      if (lcd->cy != y || lcd->cx > x || x - lcd->cx > LCD_FB_GAP)
+      {
+        lcdPosition(lcd, x, y);
+        lcd->moves++;
+      }
+      for (; lcd->cx < x; lcd->cx++)
+      {
+        lcdWrite(lcd, 1, lcd->shown[y][lcd->cx]);
+        lcd->cellsSent++;
+        lcd->cellsSkipped--;
+      }
+      lcdWrite(lcd, 1, lcd->fb[y][x]);
+      lcd->shown[y][x] = lcd->fb[y][x];
+      lcd->cellsSent++;
+      // after the last column the display address points past the row: then
+      // lcd->cx == lcd->cols, and the next cell, here or in lcdPutchar, needs a move
+      lcd->cx = x + 1;
+    }
+    lcd->cellsSkipped += lcd->cols - 1 - last;
+  }
+}
+
+/* show @line0@ and @line1@ on the first two rows, through the framebuffer */
+void lcdShow(struct lcdDataStruct *lcd, const char *line0, const char *line1)
+{
+  lcdFbClear(lcd);
+  lcdFbPuts(lcd, 0, 0, line0);
+  lcdFbPuts(lcd, 0, 1, line1);
+  lcdFlush(lcd);
+}
+
 /* ======================================================= */
 /* SECTION: aux functions for game logic                   */
 /* ------------------------------------------------------- */
 /* interface on top of the low-level pin I/O code */
 
-/* blink the led on pin @led@, @c@ times */
+/* blink the led on pin @led@, @c@ times, DELAY ms on and DELAY ms off; this */
+/* queues the blinks (see ledBlink) and returns at once                      */
 void blinkN(uint32_t *gpio, int led, int c)
 {
-  for (int i = 0; i < c; i++)
+  (void)gpio;
+  ledBlink(led, c, 2 * DELAY * 1000);
+}
+
+/* ======================================================= */
+/* SECTION: game engine                                    */
+/* ------------------------------------------------------- */
+/* The game is a state machine driven by one epoll loop, over the timerfd   */
+/* (see timerArm), the edge events of the button and stdin. Each state does */
+/* its work when it is entered (gameEnter), and then either waits for input */
+/* or arms a timer for the next state. Nothing sleeps, so the loop handles  */
+/* a button edge as soon as it arrives, and is idle in between.              */
+
+// states of the game, in the order they are normally visited
+#define GAME_WELCOME 0      // welcome screen
+#define GAME_START 1        // "Press enter to start": waiting for a line on stdin
+#define GAME_ROUND 2        // "Starting Round: n"
+#define GAME_PROMPT 3       // "Press the button now"
+#define GAME_INPUT 4        // counting presses, until TIMEOUT or colors presses
+#define GAME_PEG 5          // red LED on, then the count on green: the input window has ended
+#define GAME_PEG_SHOWN 6    // next peg, or the answer
+#define GAME_ANSWER 7       // all pegs are in: score the guess
+#define GAME_ANSWER_EXACT 8 // exact matches on green
+#define GAME_ANSWER_APPROX 9 // "n exact" on the LCD, one red blink, approximate matches on green
+#define GAME_ANSWER_SHOWN 10 // "n approximate" on the LCD
+#define GAME_ROUND_OVER 11  // the secret was found, or the red LED blinks 3 times
+#define GAME_NEXT_ROUND 12  // "Starting next round"
+#define GAME_WON 13         // "SUCCESS"
+#define GAME_WON_SHOWN 14   // number of attempts
+#define GAME_LOST 15        // "YOU LOSE!"
+#define GAME_ENDING 16      // "Ending game"
+#define GAME_OVER 17        // leave the event loop
+
+// rounds the player has to find the secret
+#define GAME_ROUNDS 5
+
+// the candidates are pruned in slices of this many words (64 codes each), one per
+// tick of a timer with this period (us), so that a large code space (8x9 has 43M
+// codes) does not hold up the event loop; a slice takes about a ms on x86-64
+#define GAME_PRUNE_WORDS 2048
+#define GAME_PRUNE_US 1000
+
+// sources of events, in epoll_event.data
+#define GAME_EV_TIMER 0
+#define GAME_EV_BUTTON 1
+#define GAME_EV_STDIN 2
+
+static struct gameStruct
+{
+  int state, next; // current state, and the state to enter when the timer fires
+  int timer;       // id of the pending timer, or -1
+  int expired;     // set by the timer callback, handled by the event loop
+  int waitLeds;    // set while waiting for the LED patterns to end (see gameAfterLeds)
+  uint64_t ledsUs; // then wait this long before entering next
+  int epfd, onStdin;
+  struct lcdDataStruct *lcd;
+  int ledGreen, ledRed, verbose;
+  int hintMs; // time budget of the hint (option -H), 0 for no hint
+  int attempts, turn, presses, found, exact, approx;
+  seq_t guess;
+  struct candStruct cands; // secrets consistent with all answers so far, if candsOk
+  int candsOk;
+  int pruneTimer;             // timer of the prune in progress, or -1
+  uint64_t pruneUs;           // start of that prune
+  uint64_t inputUs;           // start of the input window
+  unsigned long wakeups;      // returns from epoll_wait
+  uint64_t cpuUs, wallUs;     // spent in gameRun
+} game = {.timer = -1, .epfd = -1, .pruneTimer = -1};
+
+static void gameTimer(int id)
+{
+  (void)id;
+  game.expired = 1;
+}
+
+/* the prune of the candidates is done: report it */
+static void gamePruned(void)
+{
+  printf("%d possible secrets left\n", game.cands.count);
+  if (game.verbose)
+    fprintf(stderr, "Candidates: %lu words scored, %lu empty words skipped, %llu us\n", game.cands.wordsScored,
+            game.cands.wordsSkipped, (unsigned long long)(timeInMicroseconds() - game.pruneUs));
+}
+
+/* prune the next slice of the candidates, and stop the timer after the last one */
+static void gamePruneTick(int id)
+{
+  if (!candPruneStep(&game.cands, GAME_PRUNE_WORDS))
+    return;
+  timerCancel(id);
+  game.pruneTimer = -1;
+  gamePruned();
+}
+
+/* finish the prune in progress, if any, right now */
+static void gamePruneFinish(void)
+{
+  if (game.pruneTimer < 0)
+    return;
+  timerCancel(game.pruneTimer);
+  game.pruneTimer = -1;
+  candPruneStep(&game.cands, game.cands.nwords);
+  gamePruned();
+}
+
+/* enter state @next@ in @us@ microseconds */
+static void gameAfter(uint64_t us, int next)
+{
+  game.next = next;
+  game.timer = timerArm(us, 0, gameTimer);
+}
+
+/* enter state @next@ @us@ microseconds after the LED patterns have ended; */
+/* if no pattern is running (e.g. 0 blinks), nothing would wake the loop   */
+/* up to notice, so arm the timer straight away                            */
+static void gameAfterLeds(uint64_t us, int next)
+{
+  if (!ledBusy())
+  {
+    gameAfter(us, next);
+    return;
+  }
+  game.next = next;
+  game.ledsUs = us;
+  game.waitLeds = 1;
+}
+
+/* start or stop waiting for a line on stdin; returns -1 if stdin cannot be */
+/* waited for (e.g. a regular file), which then is read directly            */
+static int gameStdin(int on)
+{
+  struct epoll_event ev = {.events = EPOLLIN, .data.u32 = GAME_EV_STDIN};
+
+  if (on == game.onStdin)
+    return 0;
+  if (epoll_ctl(game.epfd, on ? EPOLL_CTL_ADD : EPOLL_CTL_DEL, STDIN_FILENO, &ev) != 0)
+    return -1;
+  game.onStdin = on;
+  return 0;
+}
+
+/* do the work of state @state@, and arrange for the state after it */
+static void gameEnter(int state)
+{
+  struct lcdDataStruct *lcd = game.lcd;
+  char buf[32];
+  int matches;
+
+  if (game.timer >= 0)
+    timerCancel(game.timer);
+  game.timer = -1;
+  game.expired = game.waitLeds = 0;
+  game.state = state;
+
+  switch (state)
+  {
+  case GAME_WELCOME:
+    lcdShow(lcd, "Welcome to", " MasterMind");
+    gameAfter(2000000, GAME_START);
+    break;
+
+  case GAME_START:
+    lcdShow(lcd, "Press enter", "to start");
+    if (gameStdin(1) != 0)
+    {
+      waitForEnter();
+      gameEnter(GAME_ROUND);
+      break;
+    }
+    printf("Press ENTER to continue: ");
+    fflush(stdout);
+    break;
+
+  case GAME_ROUND:
+    // Turn LED off if was ON previous game
+    ledOff(game.ledGreen, 0);
+    ledOff(game.ledRed, 0);
+    game.turn = 0;
+    game.guess = 0;
+    printf("Round: %d\n", game.attempts += 1);
+    sprintf(buf, "Round: %d", game.attempts);
+    lcdShow(lcd, "Starting", buf);
+    gameAfter(2000000, GAME_PROMPT);
+    break;
+
+  case GAME_PROMPT:
+    printf("Turn: %d\n", game.turn += 1);
+    printf("Enter a sequence of %d numbers\n", seqlen);
+    lcdShow(lcd, "Press the button", "now");
+    gameAfter(1000000, GAME_INPUT);
+    break;
+
+  case GAME_INPUT:
+    // presses before the window opened do not count
+    lcdShow(lcd, "", "");
+    game.presses = 0;
+    buttonFlush();
+    timed_out = 0;
+    game.timer = timerArm(TIMEOUT, 0, turnTimeout);
+    game.inputUs = timeInMicroseconds();
+    break;
+
+  case GAME_PEG:
+    if (game.verbose)
+      fprintf(stderr, "Input window: %.3f s\n", (double)(timeInMicroseconds() - game.inputUs) / 1000000);
+    printf("Button pressed %d times\n", game.presses);
+    // red LED on for 2 seconds to show the end of the time window, then blink
+    // the number of times the button was pressed on green
+    ledSolid(game.ledRed, 2000000);
+    ledOff(game.ledGreen, 2000000);
+    blinkN(gpio, game.ledGreen, game.presses);
+    game.guess = setPeg(game.guess, game.turn - 1, game.presses);
+    gameAfterLeds(0, GAME_PEG_SHOWN);
+    break;
+
+  case GAME_PEG_SHOWN:
+    gameAfter(500000, game.turn == seqlen ? GAME_ANSWER : GAME_PROMPT);
+    break;
+
+  case GAME_ANSWER:
+    // blink red LED twice to indicate the end of the attempt
+    blinkN(gpio, game.ledRed, 2);
+    matches = countMatchesPacked(game.guess, theSeq);
+    game.exact = MATCH_EXACT(matches);
+    game.approx = MATCH_APPROX(matches);
+    printf("%d exact \n", game.exact);
+    printf("%d approximate \n", game.approx);
+    if (game.candsOk)
+    { // prune in slices, from a timer; there is no slice left from last round, in practice
+      gamePruneFinish();
+      candPruneStart(&game.cands, game.guess, matches);
+      game.pruneUs = timeInMicroseconds();
+      game.pruneTimer = timerArm(0, GAME_PRUNE_US, gamePruneTick);
+      if (game.pruneTimer < 0)
+      { // no timer left: all at once
+        candPruneStep(&game.cands, game.cands.nwords);
+        gamePruned();
+      }
+    }
+    gameAfterLeds(500000, GAME_ANSWER_EXACT);
+    break;
+
+  case GAME_ANSWER_EXACT:
+    lcdShow(lcd, "", "");
+    blinkN(gpio, game.ledGreen, game.exact);
+    gameAfterLeds(0, GAME_ANSWER_APPROX);
+    break;
+
+  case GAME_ANSWER_APPROX:
+    sprintf(buf, "%d exact", game.exact);
+    lcdFbPuts(lcd, 1, 0, buf);
+    lcdFlush(lcd);
+    // separator: one red blink, while green waits for it
+    blinkN(gpio, game.ledRed, 1);
+    ledOff(game.ledGreen, 2 * DELAY * 1000);
+    blinkN(gpio, game.ledGreen, game.approx);
+    gameAfterLeds(0, GAME_ANSWER_SHOWN);
+    break;
+
+  case GAME_ANSWER_SHOWN:
+    sprintf(buf, "%d approximate", game.approx);
+    lcdFbPuts(lcd, 1, 1, buf);
+    lcdFlush(lcd);
+    gameAfter(1000000, GAME_ROUND_OVER);
+    break;
+
+  case GAME_ROUND_OVER:
+    lcdShow(lcd, "", "");
+    if (game.exact == seqlen)
+    {
+      game.found = 1;
+      gameEnter(GAME_WON);
+      break;
+    }
+    // the hint needs the candidates; a prune that is still running is not waited for
+    if (game.hintMs > 0 && game.candsOk && game.pruneTimer >= 0 && game.verbose)
+      fprintf(stderr, "Hint: skipped, the candidates are still being pruned\n");
+    if (game.hintMs > 0 && game.candsOk && game.pruneTimer < 0)
+    {
+      seq_t hint;
+      char digits[MAX_SEQL + 1];
+      uint64_t t0 = timeInMicroseconds();
+
+      if (candHint(&game.cands, (uint64_t)game.hintMs * 1000, &hint) > 0)
+      {
+        printf("Hint: %s\n", seqString(hint, digits));
+        sprintf(buf, "Hint: %s", digits);
+        sprintf(buf + 16, "%d left", game.cands.count);
+        lcdShow(lcd, buf, buf + 16);
+      }
+      if (game.verbose)
+        fprintf(stderr, "Hint: %lu guesses tried against %d candidates%s in %llu us, largest partition %d\n",
+                game.cands.hintTried, game.cands.hintSample, game.cands.hintDone ? " (all codes)" : "",
+                (unsigned long long)(timeInMicroseconds() - t0), game.cands.hintWorst);
+    }
+    blinkN(gpio, game.ledRed, 3);
+    gameAfterLeds(500000, GAME_NEXT_ROUND);
+    break;
+
+  case GAME_NEXT_ROUND:
+    printf("Starting next round\n");
+    gameAfter(2000000, game.attempts < GAME_ROUNDS ? GAME_ROUND : GAME_LOST);
+    break;
+
+  case GAME_WON:
+    printf("SUCCESS\n");
+    lcdShow(lcd, "SUCCESS", "");
+    gameAfter(500000, GAME_WON_SHOWN);
+    break;
+
+  case GAME_WON_SHOWN:
+    sprintf(buf, "Attempts: %d", game.attempts);
+    lcdFbPuts(lcd, 0, 1, buf);
+    lcdFlush(lcd);
+    // Blink green LED three times
+    ledSolid(game.ledRed, 0);
+    blinkN(gpio, game.ledGreen, 3);
+    gameAfterLeds(500000, GAME_ENDING);
+    break;
+
+  case GAME_LOST:
+    fprintf(stdout, "Sequence not found\n");
+    lcdShow(lcd, "YOU LOSE!", "");
+    gameAfter(5000000, GAME_ENDING);
+    break;
+
+  case GAME_ENDING:
+    lcdShow(lcd, "Ending game", "");
+    gameAfter(1000000, GAME_OVER);
+    break;
+
+  case GAME_OVER:
+    lcdShow(lcd, "", "");
+    ledOff(game.ledRed, 0);
+    break;
+  }
+}
+
+/* a debounced event of the button, in the input window */
+static void gameButton(int ev)
+{
+  if (ev == BUTTON_PRESS)
+  {
+    game.presses++;
+    fprintf(stderr, "Button pressed\n");
+    lcdShow(game.lcd, "Button Pressed", "");
+    // no more pegs than colours; the window closes on the last one
+    if (game.presses >= colors)
+      gameEnter(GAME_PEG);
+  }
+  else if (ev == BUTTON_RELEASE)
+    lcdShow(game.lcd, "", "");
+}
+
+/* a line, or the end of the file, on stdin starts the game */
+static void gameLine(void)
+{
+  char buf[256];
+  ssize_t n = read(STDIN_FILENO, buf, sizeof(buf));
+
+  if (n > 0 && memchr(buf, '\n', n) == NULL)
+    return;
+  gameStdin(0);
+  if (game.state == GAME_START)
+    gameEnter(GAME_ROUND);
+}
+
+/* play one game; returns 0, or -1 if the event loop could not be set up */
+int gameRun(void)
+{
+  struct epoll_event ev = {.events = EPOLLIN}, evs[4];
+  struct timespec cpu0, cpu1;
+  uint64_t wall0 = timeInMicroseconds(), wake = 0, now;
+  int i, n, wait;
+
+  game.epfd = epoll_create1(EPOLL_CLOEXEC);
+  ev.data.u32 = GAME_EV_TIMER;
+  if (game.epfd < 0 || epoll_ctl(game.epfd, EPOLL_CTL_ADD, timerFd, &ev) != 0)
+    return -1;
+  ev.data.u32 = GAME_EV_BUTTON;
+  if (button.fd >= 0 && epoll_ctl(game.epfd, EPOLL_CTL_ADD, button.fd, &ev) != 0)
+    return -1;
+  clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &cpu0);
+
+  gameEnter(GAME_WELCOME);
+  while (game.state != GAME_OVER)
   {
-    digitalWrite(gpio, led, HIGH);
-    usleep(DELAY * 1000);
+    // in the input window, wake up for a debounce window that may still report a
+    // change; without edge events the button has to be sampled, every ms
+    wait = -1;
+    if (game.state == GAME_INPUT && button.fd < 0)
+      wait = 1;
+    else if (game.state == GAME_INPUT && wake != 0)
+      wait = (now = gpioNowUs()) < wake ? (int)((wake - now + 999) / 1000) : 0;
+
+    n = epoll_wait(game.epfd, evs, 4, wait);
+    if (n < 0 && errno != EINTR)
+      return -1;
+    game.wakeups++;
+    for (i = 0; i < n; i++)
+      if (evs[i].data.u32 == GAME_EV_TIMER)
+        timer_handler(0);
+      else if (evs[i].data.u32 == GAME_EV_STDIN)
+        gameLine();
+
+    // button edges only count in the input window; drain them in any case,
+    // so that they do not keep the edge fd readable
+    wake = 0;
+    if (game.state == GAME_INPUT)
+    {
+      int e;
+      while (game.state == GAME_INPUT && (e = buttonPoll(&wake)) != BUTTON_NONE)
+        gameButton(e);
+    }
+    else if (button.fd >= 0)
+      buttonFlush();
 
-    digitalWrite(gpio, led, LOW);
-    usleep(DELAY * 1000);
+    if (timed_out && game.state == GAME_INPUT)
+    {
+      game.timer = -1;
+      gameEnter(GAME_PEG);
+    }
+    else if (game.expired)
+    {
+      game.timer = -1;
+      gameEnter(game.next);
+    }
+    else if (game.waitLeds && !ledBusy())
+    {
+      game.waitLeds = 0;
+      if (game.ledsUs > 0)
+        gameAfter(game.ledsUs, game.next);
+      else
+        gameEnter(game.next);
+    }
   }
+
+  clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &cpu1);
+  game.cpuUs = (uint64_t)(cpu1.tv_sec - cpu0.tv_sec) * 1000000 + (cpu1.tv_nsec - cpu0.tv_nsec) / 1000;
+  game.wallUs = timeInMicroseconds() - wall0;
+  gameStdin(0);
+  close(game.epfd);
+  game.epfd = -1;
+  return 0;
 }
 
 /* ======================================================= */
@@ -762,9 +2156,8 @@ int main(int argc, char *argv[])
   int bits, rows, cols;
   unsigned char func;
 
-  int found = 0, attempts = 0, i, j, code;
+  int i, j, code;
   int c, d, buttonPressed, rel, foo;
-  int *attSeq;
 
   int pinLED = LED, pin2LED2 = LED2, pinButton = BUTTON;
   int fSel, shift, pin, clrOff, setOff, off, res;
@@ -777,18 +2170,21 @@ int main(int argc, char *argv[])
   struct timeval t1, t2;
   int t;
 
-  char buf[32];
-
   // variables for command-line processing
   char str_in[20], str[20] = "some text";
-  int verbose = 0, debug = 0, help = 0, opt_m = 0, opt_n = 0, opt_s = 0, unit_test = 0, res_matches = 0;
+  int verbose = 0, debug = 0, help = 0, opt_m = 0, opt_n = 0, opt_s = 0, opt_k = 0, unit_test = 0, stream_test = 0, res_matches = 0;
+  int threads = (int)sysconf(_SC_NPROCESSORS_ONLN), strategy = SOLVER_MINIMAX;
+  int debounceMs = DEBOUNCE_US / 1000, samples = 0, hintMs = 0;
+  uint64_t seed = 0;
+  int seedSet = 0;
+  const char *gpioSpec = "mem", *traceFile = NULL, *secretArg = NULL;
 
   // -------------------------------------------------------
   // process command-line arguments
   // see: man 3 getopt for docu and an example of command line parsing
   {
     int opt;
-    while ((opt = getopt(argc, argv, "hvdus:")) != -1)
+    while ((opt = getopt(argc, argv, "hvdkuUs:L:C:t:a:G:T:b:r:n:H:")) != -1)
     {
       switch (opt)
       {
@@ -804,11 +2200,57 @@ int main(int argc, char *argv[])
       case 'u':
         unit_test = 1;
         break;
+      case 'U':
+        stream_test = 1;
+        break;
+      case 'k':
+        opt_k = 1;
+        break;
       case 's':
         opt_s = atoi(optarg);
+        secretArg = optarg;
+        break;
+      case 'L':
+        seqlen = atoi(optarg);
+        break;
+      case 'C':
+        colors = atoi(optarg);
+        break;
+      case 't':
+        threads = atoi(optarg);
+        break;
+      case 'G':
+        gpioSpec = optarg;
+        break;
+      case 'T':
+        traceFile = optarg;
+        break;
+      case 'b':
+        if ((debounceMs = atoi(optarg)) < 0)
+        {
+          fprintf(stderr, "Invalid debounce window %s; use a number of ms >= 0\n", optarg);
+          exit(EXIT_FAILURE);
+        }
+        break;
+      case 'r':
+        seed = strtoull(optarg, NULL, 0);
+        seedSet = 1;
+        break;
+      case 'n':
+        samples = atoi(optarg);
+        break;
+      case 'H':
+        hintMs = atoi(optarg);
+        break;
+      case 'a':
+        if ((strategy = solverStrategy(optarg)) < 0)
+        {
+          fprintf(stderr, "Unknown strategy %s; use minimax, first or random\n", optarg);
+          exit(EXIT_FAILURE);
+        }
         break;
       default: /* '?' */
-        fprintf(stderr, "Usage: %s [-h] [-v] [-d] [-u <seq1> <seq2>] [-s <secret seq>]  \n", argv[0]);
+        fprintf(stderr, "Usage: %s [-h] [-v] [-d] [-k] [-a <strategy>] [-t <threads>] [-L <length>] [-C <colours>] [-G <gpio backend>] [-T <trace file>] [-b <debounce ms>] [-r <seed>] [-n <secrets>] [-H <hint ms>] [-u <seq1> <seq2>] [-U [<file>]] [-s <secret seq>]  \n", argv[0]);
         exit(EXIT_FAILURE);
       }
     }
@@ -818,8 +2260,17 @@ int main(int argc, char *argv[])
   {
     fprintf(stderr, "MasterMind program, running on a Raspberry Pi, with connected LED, button and LCD display\n");
     fprintf(stderr, "Use the button for input of numbers. The LCD display will show the matches with the secret sequence.\n");
+    fprintf(stderr, "Use -L and -C to play with sequences of up to %d pegs and up to %d colours (default %dx%d).\n", MAX_SEQL, MAX_COLS, SEQL, COLS);
+    fprintf(stderr, "With -k the minimax solver plays the secret given by -s, or every possible secret, without any hardware.\n");
+    fprintf(stderr, "With -U the matching function scores pairs of sequences read from <file> or stdin, one pair per line.\n");
+    fprintf(stderr, "Use -G anon or -G file:<path> to run on a simulated GPIO block instead of /dev/mem, and -T <file> to save its pin transitions.\n");
+    fprintf(stderr, "Use -b <ms> to set the debounce window of the button (default %d ms).\n", DEBOUNCE_US / 1000);
+    fprintf(stderr, "Use -a to pick the solver strategy (minimax, first or random), and -t to set the number of threads for -k.\n");
+    fprintf(stderr, "With -k -n <secrets> the solver plays a random sample of secrets instead of all of them.\n");
+    fprintf(stderr, "Use -H <ms> to show a hint for the next guess after each round, computed within <ms> milliseconds.\n");
+    fprintf(stderr, "Use -r <seed> to make the secret, the random strategy and the sample of -n reproducible.\n");
     fprintf(stderr, "For full specification of the program see: https://www.macs.hw.ac.uk/~hwloidl/Courses/F28HS/F28HS_CW2_2022.pdf\n");
-    fprintf(stderr, "Usage: %s [-h] [-v] [-d] [-u <seq1> <seq2>] [-s <secret seq>]  \n", argv[0]);
+    fprintf(stderr, "Usage: %s [-h] [-v] [-d] [-k] [-a <strategy>] [-t <threads>] [-L <length>] [-C <colours>] [-G <gpio backend>] [-T <trace file>] [-b <debounce ms>] [-r <seed>] [-n <secrets>] [-H <hint ms>] [-u <seq1> <seq2>] [-U [<file>]] [-s <secret seq>]  \n", argv[0]);
     exit(EXIT_SUCCESS);
   }
 
@@ -841,14 +2292,23 @@ int main(int argc, char *argv[])
     fprintf(stdout, "Verbose is %s\n", (verbose ? "ON" : "OFF"));
     fprintf(stdout, "Debug is %s\n", (debug ? "ON" : "OFF"));
     fprintf(stdout, "Unittest is %s\n", (unit_test ? "ON" : "OFF"));
+    fprintf(stdout, "Sequence length %d, %d colours\n", seqlen, colors);
     if (opt_s)
       fprintf(stdout, "Secret sequence set to %d\n", opt_s);
   }
 
-  seq1 = (int *)malloc(seqlen * sizeof(int));
-  seq2 = (int *)malloc(seqlen * sizeof(int));
-  cpy1 = (int *)malloc(seqlen * sizeof(int));
-  cpy2 = (int *)malloc(seqlen * sizeof(int));
+  if (codesInit(seqlen, colors) != 0)
+    failure(TRUE, "setup: unsupported sequence length %d or number of colours %d\n", seqlen, colors);
+
+  // the secret has to fit the code space, which is only known now that -L and -C are read
+  if (secretArg != NULL)
+  {
+    int i;
+    for (i = 0; secretArg[i] >= '1' && secretArg[i] <= '0' + colors; i++)
+      ;
+    if (i != seqlen || secretArg[i] != '\0')
+      failure(TRUE, "setup: secret %s is not a sequence of %d digits between 1 and %d\n", secretArg, seqlen, colors);
+  }
 
   // check for -u option, and if so run a unit test on the matching function
   if (unit_test && argc > optind + 1)
@@ -858,11 +2318,11 @@ int main(int argc, char *argv[])
     strcpy(str_in, argv[optind + 1]);
     opt_n = atoi(str_in);
     // CALL a test-matches function; see testm.c for an example implementation
-    readSeq(seq1, opt_m); // turn the integer number into a sequence of numbers
-    readSeq(seq2, opt_n); // turn the integer number into a sequence of numbers
+    seq_t seq1 = parseSeq(opt_m); // turn the integer number into a sequence of numbers
+    seq_t seq2 = parseSeq(opt_n); // turn the integer number into a sequence of numbers
     if (verbose)
       fprintf(stdout, "Testing matches function with sequences %d and %d\n", opt_m, opt_n);
-    res_matches = countMatches(seq1, seq2);
+    res_matches = countMatchesPacked(seq1, seq2);
     showMatches(res_matches, seq1, seq2, 1);
     exit(EXIT_SUCCESS);
   }
@@ -871,11 +2331,23 @@ int main(int argc, char *argv[])
     /* nothing to do here; just continue with the rest of the main fct */
   }
 
+  // check for -U option, and if so score a stream of pairs, e.g. for bulk validation
+  if (stream_test)
+  {
+    FILE *in = stdin;
+    long bad;
+
+    if (optind < argc && strcmp(argv[optind], "-") != 0 && (in = fopen(argv[optind], "r")) == NULL)
+      failure(TRUE, "Cannot open %s\n", argv[optind]);
+    bad = streamMatches(in, stdout);
+    if (in != stdin)
+      fclose(in);
+    exit(bad == 0 ? EXIT_SUCCESS : EXIT_FAILURE);
+  }
+
   if (opt_s)
   { // if -s option is given, use the sequence as secret sequence
-    if (theSeq == NULL)
-      theSeq = (int *)malloc(seqlen * sizeof(int));
-    readSeq(theSeq, opt_s);
+    theSeq = parseSeq(opt_s);
     if (verbose)
     {
       fprintf(stderr, "Running program with secret sequence:\n");
@@ -883,6 +2355,73 @@ int main(int argc, char *argv[])
     }
   }
 
+  // check for -k option, and if so let the solver play, without touching the hardware
+  if (opt_k)
+  {
+    struct solverStruct solver;
+    struct simResult sim;
+    int guesses[SOLVER_MAX_GUESSES];
+    int k, n, idx;
+    char digits[MAX_SEQL + 1];
+    uint64_t t0, t1;
+
+    // small code spaces get an all-pairs answer table; others score through countMatches
+    tableInit(seqlen, colors, countMatches);
+
+    if (opt_s)
+    { // play the given secret, showing every guess and answer
+      if (solverInit(&solver, seqlen, colors) != 0)
+        failure(TRUE, "solver: out of memory\n");
+      solver.strategy = strategy;
+      rngSeed(&solver.rng, seedSet ? seed : rngSeedDefault());
+      t0 = timeInMicroseconds();
+      n = solverPlay(&solver, theSeq, guesses);
+      t1 = timeInMicroseconds();
+      if (n < 0)
+        failure(TRUE, "solver: secret not found within %d guesses\n", SOLVER_MAX_GUESSES);
+      for (k = 0; k < n; k++)
+      {
+        seq_t g = solverCode(&solver, guesses[k]);
+        res_matches = countMatchesPacked(theSeq, g);
+        printf("Guess %d: %s", k + 1, seqString(g, digits));
+        printf(" -> %d exact, %d approximate\n", MATCH_EXACT(res_matches), MATCH_APPROX(res_matches));
+      }
+      printf("Solved in %d guesses (%llu us)\n", n, (unsigned long long)(t1 - t0));
+      solverFree(&solver);
+    }
+    else
+    { // play every secret of the code space, or a sample (-n), on all cores, and report the distribution of guesses
+      // without -r the run is still reproducible, from a fixed seed
+      if (simRun(seqlen, colors, strategy, threads, seedSet ? seed : 1701, samples, &sim) != 0)
+        failure(TRUE, "sim: out of memory or unsupported number of threads %d\n", threads);
+      if (verbose)
+        for (idx = 0; idx < sim.ncodes; idx++)
+        {
+          seq_t code = 0;
+          if (sim.secrets != NULL)
+            code = sim.secrets[idx];
+          else
+            for (k = seqlen - 1, n = idx; k >= 0; k--, n /= colors)
+              code = setPeg(code, k, n % colors + 1);
+          printf("%s: %d guesses\n", seqString(code, digits), sim.guesses[idx]);
+        }
+      if (sim.failed > 0)
+        failure(TRUE, "solver: %d secrets not found\n", sim.failed);
+      printf("%d secrets, %.3f guesses on average, %d at most\n", sim.ncodes, (double)sim.total / sim.ncodes, sim.worst);
+      for (n = 1; n <= sim.worst; n++)
+        if (sim.hist[n] > 0)
+          printf("%2d guesses: %d secrets (%.2f%%)\n", n, sim.hist[n], 100.0 * sim.hist[n] / sim.ncodes);
+      printf("Wall time: %llu us (%.1f us per secret), %d threads, %lld steals\n",
+             (unsigned long long)sim.wallUs, (double)sim.wallUs / sim.ncodes, sim.threads, sim.steals);
+      if (sim.secrets != NULL)
+        printf("Sample of %d secrets drawn in %llu us (%.1f million per second)\n", sim.ncodes,
+               (unsigned long long)sim.drawUs, sim.drawUs ? (double)sim.ncodes / sim.drawUs : 0.0);
+      simFree(&sim);
+    }
+    tableFree();
+    exit(EXIT_SUCCESS);
+  }
+
   // -------------------------------------------------------
   // LCD constants, hard-coded: 16x2 display, using a 4-bit connection
   bits = 4;
@@ -892,28 +2431,22 @@ int main(int argc, char *argv[])
 
   printf("Raspberry Pi LCD driver, for a %dx%d display (%d-bit wiring) \n", cols, rows, bits);
 
-  if (geteuid() != 0)
+  if (strcmp(gpioSpec, "mem") == 0 && geteuid() != 0)
     fprintf(stderr, "setup: Must be root. (Did you forget sudo?)\n");
 
-  // init of guess sequence, and copies (for use in countMatches)
-  attSeq = (int *)malloc(seqlen * sizeof(int));
-  cpy1 = (int *)malloc(seqlen * sizeof(int));
-  cpy2 = (int *)malloc(seqlen * sizeof(int));
-
   // -----------------------------------------------------------------------------
   // constants for RPi3
   gpiobase = 0x3F200000;
 
   // -----------------------------------------------------------------------------
-  // memory mapping
-  // Open the master /dev/memory device
-  if ((fd = open("/dev/mem", O_RDWR | O_SYNC | O_CLOEXEC)) < 0)
-    return failure(FALSE, "setup: Unable to open /dev/mem: %s\n", strerror(errno));
+  // memory mapping: the GPIO registers through /dev/mem, or a simulated register block
+  if ((gpio = gpioOpen(gpioSpec, gpiobase)) == NULL)
+    return failure(FALSE, "setup: no GPIO backend\n");
 
-  // GPIO:
-  gpio = (uint32_t *)mmap(0, BLOCK_SIZE, PROT_READ | PROT_WRITE, MAP_SHARED, fd, gpiobase);
-  if ((int32_t)gpio == -1)
-    return failure(FALSE, "setup: mmap (GPIO) failed: %s\n", strerror(errno));
+  // decide which waits in delayMicroseconds are short enough to spin
+  delayCalibrate();
+  if (timerInit() < 0)
+    return failure(FALSE, "setup: timerfd_create failed: %s\n", strerror(errno));
 
   // -------------------------------------------------------
   // Configuration of LED, BUTTON and LCD pins
@@ -927,12 +2460,15 @@ int main(int argc, char *argv[])
   pinMode(gpio, DATA2_PIN, OUTPUT);
   pinMode(gpio, DATA3_PIN, OUTPUT);
 
+  // button presses come as debounced edge events
+  buttonInit(pinButton, (uint64_t)debounceMs * 1000);
+
   // -------------------------------------------------------
   // INLINED version of lcdInit (can only deal with one LCD attached to the RPi):
   // you can use this code as-is, but you need to implement digitalWrite() and
   // pinMode() which are called from this code
   // Create a new LCD:
-  lcd = (struct lcdDataStruct *)malloc(sizeof(struct lcdDataStruct));
+  lcd = (struct lcdDataStruct *)calloc(1, sizeof(struct lcdDataStruct));
   if (lcd == NULL)
     return -1;
 
@@ -949,6 +2485,7 @@ int main(int argc, char *argv[])
   lcd->dataPins[1] = DATA1_PIN;
   lcd->dataPins[2] = DATA2_PIN;
   lcd->dataPins[3] = DATA3_PIN;
+  lcdBusInit(lcd);
   // lcd->dataPins [4] = d4 ;
   // lcd->dataPins [5] = d5 ;
   // lcd->dataPins [6] = d6 ;
@@ -1006,236 +2543,73 @@ int main(int argc, char *argv[])
   lcdCursor(lcd, FALSE);
   lcdCursorBlink(lcd, FALSE);
   lcdClear(lcd);
+  lcdFbClear(lcd);
 
   lcdPutCommand(lcd, LCD_ENTRY | LCD_ENTRY_ID);     // set entry mode to increment address counter after write
   lcdPutCommand(lcd, LCD_CDSHIFT | LCD_CDSHIFT_RL); // set display shift to right-to-left
 
+  // from here on, LCD writes go through the writer thread, off the game's path
+  if (lcdWriterStart(lcd) != 0)
+    fprintf(stderr, "setup: no LCD writer thread, writing to the LCD synchronously\n");
+
   // END lcdInit ------
   // -----------------------------------------------------------------------------
   // Start of game
   fprintf(stderr, "Printing welcome message on the LCD display ...\n");
 
-  /*-------------------------------------------------------------------------------------*/
-  lcdPuts(lcd, "Welcome to");
-  lcdPosition(lcd, 1, 1);
-  lcdPuts(lcd, "MasterMind");
-  delay(2000);
-  lcdClear(lcd);
-
-  /*-------------------------------------------------------------------------------------*/
-
   /* initialise the secret sequence */
+  if (!seedSet)
+    seed = rngSeedDefault();
+  rngSetSeed(seed);
   if (!opt_s)
     initSeq();
   if (debug)
-    showSeq(theSeq);
-
-  // optionally one of these 2 calls:
-  lcdPuts(lcd, "Press enter");
-  lcdPosition(lcd, 0, 1);
-  lcdPuts(lcd, "to start");
-  waitForEnter();
-
-  // -----------------------------------------------------------------------------
-  // +++++ main loop
-  // Turn LED off if was ON previous game
-  digitalWrite(gpio, pinLED, LOW);
-  digitalWrite(gpio, pin2LED2, LOW);
-
-  // Main game loop starts here, the player has 5 attempts to guess the secret sequence
-  while (!found && attempts < 5)
   {
-    int turn = 0;
-
-    // clear the lcd from previous round
-    lcdClear(lcd);
-
-    // print the round number on the terminal
-    printf("Round: %d\n", attempts += 1);
-
-    // Print the number of attempts on the next line
-    char roundString[32];
-    lcdPuts(lcd, "Starting");
-    lcdPosition(lcd, 0, 1);
-    sprintf(roundString, "Round: %d", attempts);
-    lcdPuts(lcd, roundString);
-
-    delay(2000);
-
-    // main loop for each turn inputting the sequence
-    while (1)
-    {
-      printf("Turn: %d\n", turn += 1);
-      printf("Enter a sequence of %d numbers\n", SEQL);
-      lcdClear(lcd);
-
-      lcdPuts(lcd, "Press the button");
-      lcdPosition(lcd, 0, 1);
-      lcdPuts(lcd, "now");
-
-      // Wait for 2 seconds
-      delay(1000);
-
-      // Clear the LCD screen
-      lcdClear(lcd);
-
-      // Time window of 5 seconds
-      time_t startTime = time(NULL);
-      time_t endTime = startTime + 5;
-
-      // Count of button presses
-      int buttonPressCount = 0;
-
-      // Blink red when time window ends
-      while (time(NULL) < endTime)
-      {
-        // Wait for the button to be pressed
-        if (waitForButton(gpio, pinButton) == 1)
-        {
-          buttonPressCount++;
-          delay(500);
-          lcdPuts(lcd, "Button Pressed");
-          delay(300);
-          lcdClear(lcd);
-        }
-        if (buttonPressCount >= 3)
-        {
-          buttonPressCount = 3;
-          break;
-        }
-      }
-
-      // Print the number of button presses
-      printf("Button pressed %d times\n", buttonPressCount);
-
-      // Set redLED blink for 2 seconds to indicate the end of the time window
-      digitalWrite(gpio, pin2LED2, HIGH);
-      delay(2000);
-      digitalWrite(gpio, pin2LED2, LOW);
-
-      // Blink the number of times the button was pressed on green
-      blinkN(gpio, pinLED, buttonPressCount);
-
-      // Store the number of button presses in attSeq
-      attSeq[turn - 1] = buttonPressCount;
-      // Repeat for a sequence of 3
-      if (turn <= 3)
-      {
-        // Delay before starting the next attempt
-        delay(500);
-      }
-      if (turn == 3)
-      {
-        // blink red LED twice to indicate the end of the attempt
-        blinkN(gpio, pin2LED2, 2);
-        break;
-      }
-    }
-
-    // Compare the sequence with the secret sequence
-    int matches = countMatches(attSeq, theSeq);
-    int approx = matches % 10;
-    int exact = (matches - approx) / 10;
-
-    printf("%d exact \n", exact);
-    printf("%d approximate \n", approx);
-
-    delay(500);
-
-    // prints exact on the lcd
-    lcdClear(lcd);
-    blinkN(gpio, pinLED, exact);
-    sprintf(buf, "%d exact", exact);
-    lcdPosition(lcd, 1, 0);
-    lcdPuts(lcd, buf);
-
-    // separator
-    blinkN(gpio, pin2LED2, 1);
-
-    // prints approximate on the lcd
-    blinkN(gpio, pinLED, approx);
-    sprintf(buf, "%d approximate", approx);
-    lcdPosition(lcd, 1, 1);
-    lcdPuts(lcd, buf);
-
-    delay(1000);
-
-    lcdClear(lcd);
-
-    if (exact == 3)
-    {
-      found = 1;
-      break;
-    }
-    else
-    {
-      // Clear the sequence
-      for (int i = 0; i < SEQL; i++)
-      {
-        attSeq[i] = 0;
-      }
-    }
-    blinkN(gpio, pin2LED2, 3);
-
-    delay(500);
-    printf("Starting next round\n");
-    delay(2000);
+    printf("Seed: %llu\n", (unsigned long long)seed);
+    showSeq(theSeq);
   }
 
-  if (found)
+  // the game itself: a state machine, driven by an event loop (see gameRun)
+  game.lcd = lcd;
+  game.ledGreen = pinLED;
+  game.ledRed = pin2LED2;
+  game.verbose = verbose;
+  game.hintMs = hintMs;
+  game.candsOk = candInit(&game.cands, seqlen, colors) == 0;
+  if (gameRun() != 0)
+    return failure(FALSE, "game: event loop failed: %s\n", strerror(errno));
+  candFree(&game.cands);
+  lcdWriterStop();
+
+  // with a simulated backend, report what the game did on the pins
+  if (gpioBackend != GPIO_BACKEND_MEM)
   {
-    printf("SUCCESS\n");
-    lcdPuts(lcd, "SUCCESS");
-
-    // Wait for a short delay
-    usleep(500000);
-
-    // Print the number of attempts on the next line
-    lcdPosition(lcd, 0, 1);
-    char attemptsString[32];
-    sprintf(attemptsString, "Attempts: %d", attempts);
-    lcdPuts(lcd, attemptsString);
-
-    // Blink green LED three times
-    digitalWrite(gpio, pin2LED2, HIGH);
-    blinkN(gpio, pinLED, 3);
-
-    // Delay before clearing LCD
-    usleep(500000);
-    lcdClear(lcd);
-
-    lcdPuts(lcd, "Ending game");
-    usleep(1000000);
-
-    // Clear LCD
-    lcdClear(lcd);
-    writeLED(gpio, pin2LED2, 0);
+    fprintf(stderr, "GPIO transitions: LED %ld, LED2 %ld, LCD strobe %ld, RS %ld, data %ld/%ld/%ld/%ld\n",
+            gpioTransitions(pinLED), gpioTransitions(pin2LED2), gpioTransitions(STRB_PIN), gpioTransitions(RS_PIN),
+            gpioTransitions(DATA0_PIN), gpioTransitions(DATA1_PIN), gpioTransitions(DATA2_PIN), gpioTransitions(DATA3_PIN));
+    fprintf(stderr, "LCD framebuffer: %lu cells sent, %lu unchanged cells skipped, %lu cursor moves\n",
+            lcd->cellsSent, lcd->cellsSkipped, lcd->moves);
+    if (traceFile != NULL && gpioWriteTrace(traceFile) != 0)
+      fprintf(stderr, "Failed to write the GPIO trace to %s\n", traceFile);
   }
-  else
+  if (verbose || gpioBackend != GPIO_BACKEND_MEM)
   {
-    lcdClear(lcd);
-    fprintf(stdout, "Sequence not found\n");
-    lcdPuts(lcd, "YOU LOSE!");
-
-    // Delay before clearing LCD
-    delay(5000);
-    lcdClear(lcd);
-
-    lcdPuts(lcd, "Ending game");
-    usleep(1000000);
-
-    // Clear LCD
-    lcdClear(lcd);
-    writeLED(gpio, pin2LED2, 0);
+    delayReport(stderr);
+    fprintf(stderr, "pinMode: %lu GPFSEL read-modify-writes, %lu skipped (mode unchanged)\n", pinModeWrites, pinModeSkips);
+    lcdWriterReport(stderr);
+    fprintf(stderr, "game loop: %lu wake-ups, %.1f ms CPU time in %.1f s\n", game.wakeups,
+            (double)game.cpuUs / 1000, (double)game.wallUs / 1000000);
+    fprintf(stderr, "LEDs: %lu ticks, %lu writes\n", ledTicks, ledWrites);
+    fprintf(stderr, "timers: %lu fired, %.1f us late on average, %llu us at most\n", timerFired,
+            timerFired ? (double)timerLateSum / timerFired : 0.0, (unsigned long long)timerLateMax);
+    fprintf(stderr, "button: %lu presses, %lu bounces ignored, press-to-handled latency %.1f us on average, %llu us at most\n",
+            button.presses, button.db.bounces, button.presses ? (double)button.latencySum / button.presses : 0.0,
+            (unsigned long long)button.latencyMax);
   }
+  gpioEdgeClose();
+  gpioClose();
 
   // Free memory
-  free(theSeq);
-  free(seq1);
-  free(seq2);
-  free(cpy1);
-  free(cpy2);
-  free(attSeq);
   free(lcd);
 
   return 0;
@@ -0,0 +1,285 @@
+/* ***************************************************************************** */
+/* Bitset of consistent candidates, pruned a word at a time; see mm-cands.h.     */
+/* ***************************************************************************** */
+
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "mm-cands.h"
+
+// most candidates candHint scores a guess against; larger sets are sampled evenly
+#define CAND_HINT_SAMPLE 1024
+// candidates candHint walks, while sampling, between looks at the clock
+#define CAND_HINT_CLOCK 256
+
+/* set up the candidates for sequences of length @seqlen@ over @colors@ colours, */
+/* all codes to begin with; returns 0, or -1 if out of memory                   */
+int candInit(struct candStruct *c, int seqlen, int colors)
+{
+  int i, n = 1;
+
+  for (i = 0; i < seqlen; i++)
+    n *= colors;
+  c->seqlen = seqlen;
+  c->colors = colors;
+  c->ncodes = n;
+  c->nwords = (n + 63) / 64;
+  c->bits = (uint64_t *)malloc(c->nwords * sizeof(uint64_t));
+  if (c->bits == NULL || codesInit(seqlen, colors) != 0)
+  {
+    candFree(c);
+    return -1;
+  }
+  candReset(c);
+  return 0;
+}
+
+void candFree(struct candStruct *c)
+{
+  free(c->bits);
+  c->bits = NULL;
+}
+
+/* make every code a candidate again */
+void candReset(struct candStruct *c)
+{
+  memset(c->bits, 0xFF, c->nwords * sizeof(uint64_t));
+  c->pruneWord = -1;
+  // no bits past the end of the code space
+  if (c->ncodes % 64)
+    c->bits[c->nwords - 1] = (1ull << (c->ncodes % 64)) - 1;
+  c->count = c->ncodes;
+}
+
+/* the code with index @idx@, packed */
+seq_t candCode(const struct candStruct *c, int idx)
+{
+  seq_t p = 0;
+  int j;
+
+  for (j = c->seqlen - 1; j >= 0; j--, idx /= c->colors)
+    p = setPeg(p, j, idx % c->colors + 1);
+  return p;
+}
+
+/* the code after @p@ in lexicographic order (the last peg counts fastest) */
+static inline seq_t candSucc(seq_t p, int seqlen, int colors)
+{
+  int j;
+
+  for (j = seqlen - 1; j >= 0; j--)
+  {
+    if (getPeg(p, j) < colors)
+      return p + ((seq_t)1 << (j * PEG_BITS));
+    p = setPeg(p, j, 1);
+  }
+  return p;
+}
+
+/* keep only the candidates that give the encoded @answer@ (see MATCH_ENCODE) */
+/* to @guess@; returns the number of candidates left                         */
+int candPrune(struct candStruct *c, seq_t guess, int answer)
+{
+  candPruneStart(c, guess, answer);
+  candPruneStep(c, c->nwords);
+  return c->count;
+}
+
+/* start pruning as candPrune does, but leave the work to candPruneStep; until */
+/* the prune is done, the set mixes pruned and unpruned words, and count is the */
+/* size from before                                                             */
+void candPruneStart(struct candStruct *c, seq_t guess, int answer)
+{
+  c->wordsScored = c->wordsSkipped = 0;
+  c->pruneWord = 0;
+  c->pruneCount = 0;
+  c->pruneGuess = guess;
+  c->pruneAnswer = answer;
+}
+
+/* prune the next @words@ words of the bitset; returns 1 when the prune is done */
+/* (count is then up to date), or 0 if there is more to do                      */
+int candPruneStep(struct candStruct *c, int words)
+{
+  seq_t codes[64];
+  unsigned char ans[64];
+  int w, b, k, end;
+
+  if (c->pruneWord < 0)
+    return 1;
+  end = c->nwords - c->pruneWord > words ? c->pruneWord + words : c->nwords;
+  for (w = c->pruneWord; w < end; w++)
+  {
+    uint64_t word = c->bits[w], keep = 0;
+    seq_t p;
+
+    if (word == 0)
+    {
+      c->wordsSkipped++;
+      continue;
+    }
+    // gather the candidates of this word, in bit order, and score them all at once
+    p = candCode(c, w * 64);
+    for (b = 0, k = 0; b < 64 && w * 64 + b < c->ncodes; b++, p = candSucc(p, c->seqlen, c->colors))
+      if ((word >> b) & 1)
+        codes[k++] = p;
+    countMatchesBatch(c->pruneGuess, codes, k, ans);
+    for (b = 0, k = 0; word != 0; word &= word - 1, k++)
+    {
+      b = __builtin_ctzll(word);
+      if (ans[k] == c->pruneAnswer)
+        keep |= 1ull << b;
+    }
+    c->bits[w] = keep;
+    c->pruneCount += __builtin_popcountll(keep);
+    c->wordsScored++;
+  }
+  if (end < c->nwords)
+  {
+    c->pruneWord = end;
+    return 0;
+  }
+  c->pruneWord = -1;
+  c->count = c->pruneCount;
+  return 1;
+}
+
+/* the index of the first candidate at or after @idx@, or -1 if there is none */
+int candNext(const struct candStruct *c, int idx)
+{
+  int w = idx >> 6;
+  uint64_t word;
+
+  if (idx >= c->ncodes)
+    return -1;
+  word = c->bits[w] & (~0ull << (idx & 63));
+  while (word == 0)
+  {
+    if (++w == c->nwords)
+      return -1;
+    word = c->bits[w];
+  }
+  return w * 64 + __builtin_ctzll(word);
+}
+
+/* the index of the first code at or after @idx@ that is not a candidate, or -1 */
+static int candNextOther(const struct candStruct *c, int idx)
+{
+  int w = idx >> 6;
+  uint64_t word;
+
+  if (idx >= c->ncodes)
+    return -1;
+  word = ~c->bits[w] & (~0ull << (idx & 63));
+  while (word == 0)
+  {
+    if (++w == c->nwords)
+      return -1;
+    word = ~c->bits[w];
+  }
+  idx = w * 64 + __builtin_ctzll(word);
+  return idx < c->ncodes ? idx : -1;
+}
+
+/* store up to @max@ candidates, packed and in order, in @out@; returns how many */
+int candList(const struct candStruct *c, seq_t *out, int max)
+{
+  int idx, n = 0;
+
+  for (idx = candNext(c, 0); idx >= 0 && n < max; idx = candNext(c, idx + 1))
+    out[n++] = candCode(c, idx);
+  return n;
+}
+
+static uint64_t candNowUs(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000ull + ts.tv_nsec / 1000;
+}
+
+/* pick a next guess in about @budgetUs@ microseconds: the guess, among those    */
+/* tried, whose largest partition of the candidates is smallest. The candidates */
+/* (or a sample of them) are tried first, so that the hint can win, then the    */
+/* other codes in order, until the budget is used up. Each try scores one guess */
+/* against the sample with countMatchesBatch; the sample is built in one pass   */
+/* over the bitset at most, so the budget is overrun by one try, or that pass,  */
+/* at most. Returns the number of guesses tried, or -1 if there are no          */
+/* candidates                                                                   */
+int candHint(struct candStruct *c, uint64_t budgetUs, seq_t *guess)
+{
+  seq_t sample[CAND_HINT_SAMPLE], p;
+  unsigned char ans[CAND_HINT_SAMPLE];
+  int parts[MATCH_ENCODE(MAX_SEQL, 0) + 1];
+  uint64_t deadline = candNowUs() + budgetUs;
+  int g, k, idx, prev = -1, n = 0, worst, stride;
+
+  c->hintTried = 0;
+  c->hintDone = 0;
+  if (c->count == 0)
+    return -1;
+
+  // building the sample walks the bitset once at most, and stops at the deadline
+  // too, as long as there is a candidate to offer
+  if (c->count <= CAND_HINT_SAMPLE)
+    n = candList(c, sample, CAND_HINT_SAMPLE);
+  else if (c->count <= 64 * CAND_HINT_SAMPLE)
+  { // every stride-th candidate, in order
+    stride = (c->count + CAND_HINT_SAMPLE - 1) / CAND_HINT_SAMPLE;
+    for (idx = candNext(c, 0), k = 0; idx >= 0 && n < CAND_HINT_SAMPLE; idx = candNext(c, idx + 1), k++)
+    {
+      if (k % stride == 0)
+        sample[n++] = candCode(c, idx);
+      if (k % CAND_HINT_CLOCK == 0 && n > 0 && candNowUs() >= deadline)
+        break;
+    }
+  }
+  else // too many to walk: the first candidate after each of evenly spaced codes
+    for (k = 0; k < CAND_HINT_SAMPLE; k++)
+    {
+      int start = (int)((long long)c->ncodes * k / CAND_HINT_SAMPLE);
+
+      // the last candidate found is also the first one after start: no need to
+      // scan for it again, which keeps the scans to one pass over the bitset
+      if (prev >= start)
+        continue;
+      if ((idx = candNext(c, start)) < 0)
+        break;
+      sample[n++] = candCode(c, idx);
+      prev = idx;
+      if (candNowUs() >= deadline)
+        break;
+    }
+  c->hintSample = n;
+  c->hintWorst = n;
+  *guess = sample[0];
+
+  for (g = 0, idx = -1; n > 1 && c->hintWorst > 1; g++)
+  {
+    if (g < n)
+      p = sample[g];
+    else if ((idx = candNextOther(c, idx + 1)) < 0)
+    {
+      c->hintDone = 1;
+      break;
+    }
+    else
+      p = candCode(c, idx);
+    if (c->hintTried > 0 && candNowUs() >= deadline)
+      break;
+
+    countMatchesBatch(p, sample, n, ans);
+    memset(parts, 0, sizeof(parts));
+    for (k = 0, worst = 0; k < n; k++)
+      if (++parts[ans[k]] > worst)
+        worst = parts[ans[k]];
+    c->hintTried++;
+    if (worst < c->hintWorst)
+    {
+      c->hintWorst = worst;
+      *guess = p;
+    }
+  }
+  return (int)c->hintTried;
+}
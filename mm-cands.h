@@ -0,0 +1,54 @@
+/* ***************************************************************************** */
+/* Set of the secrets still consistent with the answers so far, as a dense       */
+/* bitset over the code space: bit i of word i/64 stands for the code with index */
+/* i, in the lexicographic order of mm-table.h and mm-solver.h. candPrune scores */
+/* the guess only against the codes of non-empty words, 64 at a time, through   */
+/* countMatchesBatch, and clears the bits of the codes that give another answer. */
+/* The size is kept up to date, and listing the contents costs O(codes/64) plus  */
+/* the number of candidates. For large code spaces, candPruneStart and         */
+/* candPruneStep split a prune into slices of words, so that an event loop can  */
+/* do other work in between. candHint is an anytime minimax search for a good   */
+/* next guess, that stops when its time budget is used up.                      */
+/* ***************************************************************************** */
+
+#ifndef MM_CANDS_H
+#define MM_CANDS_H
+
+#include <stdint.h>
+
+#include "mm-codes.h"
+
+struct candStruct
+{
+  int seqlen, colors;
+  int ncodes, nwords; // size of the code space, and of the bitset in 64-bit words
+  int count;          // number of candidates, i.e. of bits set
+  uint64_t *bits;
+  unsigned long wordsScored, wordsSkipped; // per candPrune, words with and without candidates
+  int pruneWord;       // next word of the prune in progress, or -1 if there is none
+  int pruneCount;      // candidates kept so far by that prune
+  int pruneAnswer;     // ... and its answer and guess
+  seq_t pruneGuess;
+  int hintSample, hintWorst; // per candHint: candidates scored against, largest partition of the hint
+  unsigned long hintTried;   // per candHint: guesses tried
+  int hintDone;              // per candHint: 1 if it ran out of guesses to try within the budget
+};
+
+int candInit(struct candStruct *c, int seqlen, int colors);
+void candFree(struct candStruct *c);
+void candReset(struct candStruct *c);
+int candPrune(struct candStruct *c, seq_t guess, int answer);
+void candPruneStart(struct candStruct *c, seq_t guess, int answer);
+int candPruneStep(struct candStruct *c, int words);
+int candNext(const struct candStruct *c, int idx);
+seq_t candCode(const struct candStruct *c, int idx);
+int candList(const struct candStruct *c, seq_t *out, int max);
+int candHint(struct candStruct *c, uint64_t budgetUs, seq_t *guess);
+
+/* 1 if the code with index @idx@ is still a candidate */
+static inline int candHas(const struct candStruct *c, int idx)
+{
+  return (c->bits[idx >> 6] >> (idx & 63)) & 1;
+}
+
+#endif
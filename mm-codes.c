@@ -0,0 +1,343 @@
+/* ***************************************************************************** */
+/* Packed sequences and batch scoring; see mm-codes.h.                           */
+/*                                                                               */
+/* All kernels use the same nibble arithmetic: for packed a and b, a^b has a     */
+/* zero nibble exactly where the pegs agree, so the number of exact matches is   */
+/* seqlen minus the number of non-zero nibbles. The same trick against a guess   */
+/* colour replicated into every peg counts how often that colour occurs, and the */
+/* total number of matches is the sum over the colours of the guess of the       */
+/* minimum of both counts. The encoded answer exact*MATCH_BASE+approx is then    */
+/* exact*MATCH_BASE + (total-exact) = exact*(MATCH_BASE-1) + total.              */
+/* ***************************************************************************** */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "mm-codes.h"
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+int codeSeqlen = 0, codeColors = 0;
+
+// bit 0 of every nibble that holds a peg, e.g. 0x111 for seqlen 3
+static uint32_t codeOnes;
+
+// the batch kernel picked by codesInit
+static void (*batchKernel)(seq_t guess, const seq_t *candidates, int n, unsigned char *out);
+static const char *batchName = "none";
+
+// the distinct colours of a guess, each replicated into every peg, and their counts
+struct guessInfo
+{
+  int ncols;
+  uint32_t rep[MAX_SEQL];
+  uint32_t cnt[MAX_SEQL];
+};
+
+/* number of non-zero pegs in @x@, where @ones@ marks the pegs in use; the */
+/* multiply sums the per-peg flags into the top nibble, which is cheaper   */
+/* than a popcount on CPUs without a popcount instruction                  */
+static inline int nonZeroPegs(uint32_t x, uint32_t ones)
+{
+  x |= x >> 2;
+  x |= x >> 1;
+  return ((x & ones) * 0x11111111u) >> 28;
+}
+
+static void guessInfo(seq_t guess, struct guessInfo *gi)
+{
+  int i, k;
+
+  gi->ncols = 0;
+  for (i = 0; i < codeSeqlen; i++)
+  {
+    uint32_t c = (guess >> (i * PEG_BITS)) & 0xF;
+    for (k = 0; k < gi->ncols; k++)
+      if (gi->rep[k] == c * codeOnes)
+        break;
+    if (k == gi->ncols)
+    {
+      gi->rep[k] = c * codeOnes;
+      gi->cnt[k] = 0;
+      gi->ncols++;
+    }
+    gi->cnt[k]++;
+  }
+}
+
+/* score @guess@ against one candidate @v@ */
+static inline int scoreScalar(const struct guessInfo *gi, seq_t guess, seq_t v)
+{
+  int k, exact = codeSeqlen - nonZeroPegs(v ^ guess, codeOnes), total = 0;
+
+  for (k = 0; k < gi->ncols; k++)
+  {
+    uint32_t occ = codeSeqlen - nonZeroPegs(v ^ gi->rep[k], codeOnes);
+    total += occ < gi->cnt[k] ? occ : gi->cnt[k];
+  }
+  return exact * (MATCH_BASE - 1) + total;
+}
+
+/* counts exact and approximate matches of @seq1@ and @seq2@ of length @len@;   */
+/* called with a constant @len@, so that the compiler unrolls it completely     */
+static inline __attribute__((always_inline)) int scorePacked(seq_t seq1, seq_t seq2, const int len)
+{
+  const uint32_t ones = 0x11111111u >> (32 - len * PEG_BITS);
+  int i, exact = len - nonZeroPegs(seq1 ^ seq2, ones), total = 0;
+  uint32_t seen = 0;
+
+  // for every distinct colour of seq1, add the smaller number of occurrences
+#pragma GCC unroll 8
+  for (i = 0; i < len; i++)
+  {
+    uint32_t c = getPeg(seq1, i), rep, occ1, occ2;
+    if (seen & (1u << c))
+      continue;
+    seen |= 1u << c;
+    rep = c * ones;
+    occ1 = len - nonZeroPegs(seq1 ^ rep, ones);
+    occ2 = len - nonZeroPegs(seq2 ^ rep, ones);
+    total += occ1 < occ2 ? occ1 : occ2;
+  }
+  return exact * (MATCH_BASE - 1) + total;
+}
+
+// one specialised single-pair kernel per sequence length
+#define PACKED_KERNEL(len)                                   \
+  static int countMatchesPacked##len(seq_t seq1, seq_t seq2) \
+  {                                                          \
+    return scorePacked(seq1, seq2, len);                     \
+  }
+PACKED_KERNEL(1)
+PACKED_KERNEL(2)
+PACKED_KERNEL(3)
+PACKED_KERNEL(4)
+PACKED_KERNEL(5)
+PACKED_KERNEL(6)
+PACKED_KERNEL(7)
+PACKED_KERNEL(8)
+
+static int (*const packedKernels[MAX_SEQL + 1])(seq_t seq1, seq_t seq2) = {
+    NULL, countMatchesPacked1, countMatchesPacked2, countMatchesPacked3, countMatchesPacked4,
+    countMatchesPacked5, countMatchesPacked6, countMatchesPacked7, countMatchesPacked8};
+
+// the single-pair kernel for the current sequence length, picked by codesInit
+int (*countMatchesPacked)(seq_t seq1, seq_t seq2) = NULL;
+
+static void batchScalar(seq_t guess, const seq_t *candidates, int n, unsigned char *out)
+{
+  struct guessInfo gi;
+
+  guessInfo(guess, &gi);
+  for (int i = 0; i < n; i++)
+    out[i] = scoreScalar(&gi, guess, candidates[i]);
+}
+
+#if defined(__x86_64__)
+
+/* number of non-zero pegs in each 32-bit lane of @x@; the multiply sums the */
+/* per-peg flags into the top nibble                                        */
+__attribute__((target("sse4.1"))) static inline __m128i nonZeroPegsSSE41(__m128i x, __m128i ones, __m128i mul)
+{
+  x = _mm_or_si128(x, _mm_srli_epi32(x, 2));
+  x = _mm_or_si128(x, _mm_srli_epi32(x, 1));
+  return _mm_srli_epi32(_mm_mullo_epi32(_mm_and_si128(x, ones), mul), 28);
+}
+
+__attribute__((target("sse4.1"))) static void batchSSE41(seq_t guess, const seq_t *candidates, int n, unsigned char *out)
+{
+  struct guessInfo gi;
+  __m128i rep[MAX_SEQL], cnt[MAX_SEQL];
+  const __m128i g = _mm_set1_epi32(guess), ones = _mm_set1_epi32(codeOnes);
+  const __m128i mul = _mm_set1_epi32(0x11111111), len = _mm_set1_epi32(codeSeqlen);
+  const __m128i lowBytes = _mm_setr_epi8(0, 4, 8, 12, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1);
+  int i, k;
+
+  guessInfo(guess, &gi);
+  for (k = 0; k < gi.ncols; k++)
+  {
+    rep[k] = _mm_set1_epi32(gi.rep[k]);
+    cnt[k] = _mm_set1_epi32(gi.cnt[k]);
+  }
+
+  for (i = 0; i + 4 <= n; i += 4)
+  {
+    __m128i v = _mm_loadu_si128((const __m128i *)(candidates + i));
+    __m128i x = _mm_xor_si128(v, g);
+    __m128i exact = _mm_sub_epi32(len, nonZeroPegsSSE41(x, ones, mul));
+    __m128i total = _mm_setzero_si128();
+    for (k = 0; k < gi.ncols; k++)
+    {
+      __m128i y = _mm_xor_si128(v, rep[k]);
+      __m128i occ = _mm_sub_epi32(len, nonZeroPegsSSE41(y, ones, mul));
+      total = _mm_add_epi32(total, _mm_min_epu32(occ, cnt[k]));
+    }
+    // exact*9 + total, then keep the low byte of every lane
+    __m128i res = _mm_add_epi32(_mm_add_epi32(_mm_slli_epi32(exact, 3), exact), total);
+    uint32_t packed = _mm_cvtsi128_si32(_mm_shuffle_epi8(res, lowBytes));
+    memcpy(out + i, &packed, sizeof(packed));
+  }
+  for (; i < n; i++)
+    out[i] = scoreScalar(&gi, guess, candidates[i]);
+}
+
+__attribute__((target("avx2"))) static inline __m256i nonZeroPegsAVX2(__m256i x, __m256i ones, __m256i mul)
+{
+  x = _mm256_or_si256(x, _mm256_srli_epi32(x, 2));
+  x = _mm256_or_si256(x, _mm256_srli_epi32(x, 1));
+  return _mm256_srli_epi32(_mm256_mullo_epi32(_mm256_and_si256(x, ones), mul), 28);
+}
+
+__attribute__((target("avx2"))) static void batchAVX2(seq_t guess, const seq_t *candidates, int n, unsigned char *out)
+{
+  struct guessInfo gi;
+  __m256i rep[MAX_SEQL], cnt[MAX_SEQL];
+  const __m256i g = _mm256_set1_epi32(guess), ones = _mm256_set1_epi32(codeOnes);
+  const __m256i mul = _mm256_set1_epi32(0x11111111), len = _mm256_set1_epi32(codeSeqlen);
+  const __m256i lowBytes = _mm256_setr_epi8(0, 4, 8, 12, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+                                            0, 4, 8, 12, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1);
+  int i, k;
+
+  guessInfo(guess, &gi);
+  for (k = 0; k < gi.ncols; k++)
+  {
+    rep[k] = _mm256_set1_epi32(gi.rep[k]);
+    cnt[k] = _mm256_set1_epi32(gi.cnt[k]);
+  }
+
+  for (i = 0; i + 8 <= n; i += 8)
+  {
+    __m256i v = _mm256_loadu_si256((const __m256i *)(candidates + i));
+    __m256i x = _mm256_xor_si256(v, g);
+    __m256i exact = _mm256_sub_epi32(len, nonZeroPegsAVX2(x, ones, mul));
+    __m256i total = _mm256_setzero_si256();
+    for (k = 0; k < gi.ncols; k++)
+    {
+      __m256i y = _mm256_xor_si256(v, rep[k]);
+      __m256i occ = _mm256_sub_epi32(len, nonZeroPegsAVX2(y, ones, mul));
+      total = _mm256_add_epi32(total, _mm256_min_epu32(occ, cnt[k]));
+    }
+    __m256i res = _mm256_add_epi32(_mm256_add_epi32(_mm256_slli_epi32(exact, 3), exact), total);
+    res = _mm256_shuffle_epi8(res, lowBytes);
+    uint32_t lo = _mm256_extract_epi32(res, 0), hi = _mm256_extract_epi32(res, 4);
+    memcpy(out + i, &lo, sizeof(lo));
+    memcpy(out + i + 4, &hi, sizeof(hi));
+  }
+  for (; i < n; i++)
+    out[i] = scoreScalar(&gi, guess, candidates[i]);
+}
+
+#elif defined(__ARM_NEON)
+
+static inline uint32x4_t nonZeroPegsNEON(uint32x4_t x, uint32x4_t ones)
+{
+  x = vorrq_u32(x, vshrq_n_u32(x, 2));
+  x = vorrq_u32(x, vshrq_n_u32(x, 1));
+  return vshrq_n_u32(vmulq_n_u32(vandq_u32(x, ones), 0x11111111), 28);
+}
+
+static void batchNEON(seq_t guess, const seq_t *candidates, int n, unsigned char *out)
+{
+  struct guessInfo gi;
+  const uint32x4_t g = vdupq_n_u32(guess), ones = vdupq_n_u32(codeOnes), len = vdupq_n_u32(codeSeqlen);
+  uint32x4_t res[2];
+  int i, j, k;
+
+  guessInfo(guess, &gi);
+
+  for (i = 0; i + 8 <= n; i += 8)
+  {
+    for (j = 0; j < 2; j++)
+    {
+      uint32x4_t v = vld1q_u32(candidates + i + 4 * j);
+      uint32x4_t exact = vsubq_u32(len, nonZeroPegsNEON(veorq_u32(v, g), ones));
+      uint32x4_t total = vdupq_n_u32(0);
+      for (k = 0; k < gi.ncols; k++)
+      {
+        uint32x4_t occ = vsubq_u32(len, nonZeroPegsNEON(veorq_u32(v, vdupq_n_u32(gi.rep[k])), ones));
+        total = vaddq_u32(total, vminq_u32(occ, vdupq_n_u32(gi.cnt[k])));
+      }
+      res[j] = vmlaq_n_u32(total, exact, 9);
+    }
+    vst1_u8(out + i, vmovn_u16(vcombine_u16(vmovn_u32(res[0]), vmovn_u32(res[1]))));
+  }
+  for (; i < n; i++)
+    out[i] = scoreScalar(&gi, guess, candidates[i]);
+}
+
+#endif
+
+/* set up the kernels for sequences of length @seqlen@ over @colors@ colours:  */
+/* pick the single-pair kernel specialised for @seqlen@, and the fastest batch */
+/* kernel this CPU supports                                                    */
+int codesInit(int seqlen, int colors)
+{
+  if (seqlen < 1 || seqlen > MAX_SEQL || colors < 1 || colors > MAX_COLS)
+    return -1;
+
+  codeSeqlen = seqlen;
+  codeColors = colors;
+  codeOnes = 0;
+  for (int i = 0; i < seqlen; i++)
+    codeOnes |= 1u << (i * PEG_BITS);
+  countMatchesPacked = packedKernels[seqlen];
+
+  batchKernel = batchScalar;
+  batchName = "scalar";
+#if defined(__x86_64__)
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx2"))
+  {
+    batchKernel = batchAVX2;
+    batchName = "avx2";
+  }
+  else if (__builtin_cpu_supports("sse4.1"))
+  {
+    batchKernel = batchSSE41;
+    batchName = "sse4.1";
+  }
+#elif defined(__ARM_NEON)
+  batchKernel = batchNEON;
+  batchName = "neon";
+#endif
+  return 0;
+}
+
+/* parse the decimal digits of @val@ as a sequence, e.g. 123 for pegs 1, 2 and 3 */
+seq_t parseSeq(int val)
+{
+  seq_t seq = 0;
+
+  for (int i = codeSeqlen - 1; i >= 0; i--, val /= 10)
+    seq = setPeg(seq, i, val % 10);
+  return seq;
+}
+
+/* write the pegs of @seq@ as a string of digits into @buf@ (MAX_SEQL+1 chars) */
+char *seqString(seq_t seq, char *buf)
+{
+  int i;
+
+  for (i = 0; i < codeSeqlen; i++)
+    buf[i] = '0' + getPeg(seq, i);
+  buf[i] = '\0';
+  return buf;
+}
+
+/* name of the batch kernel in use, for reporting */
+const char *codesKernelName(void)
+{
+  return batchName;
+}
+
+/* score @guess@ against the @n@ packed @candidates@, writing the encoded */
+/* answers (see MATCH_ENCODE) to @out@; codesInit must have been called   */
+void countMatchesBatch(seq_t guess, const seq_t *candidates, int n, unsigned char *out)
+{
+  batchKernel(guess, candidates, n, out);
+}
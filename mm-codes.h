@@ -0,0 +1,73 @@
+/* ***************************************************************************** */
+/* Packed sequences and batch scoring.                                           */
+/* A packed sequence holds peg i (0-based, left to right) in bits 4i..4i+3 of a  */
+/* 32-bit word; colours are 1..15 and unused pegs are 0. So 123 packs to 0x321.  */
+/* Packed sequences are passed by value, so they live in registers and need no   */
+/* heap allocation. countMatchesPacked scores one pair, through a kernel         */
+/* specialised for the sequence length in use; countMatchesBatch scores one guess*/
+/* against many packed candidates, using SSE4.1/AVX2 on x86-64 and NEON on ARM   */
+/* when available.                                                               */
+/* ***************************************************************************** */
+
+#ifndef MM_CODES_H
+#define MM_CODES_H
+
+#include <stdint.h>
+
+typedef uint32_t seq_t;
+
+// bits per peg in a packed sequence, and the longest sequence that fits
+#define PEG_BITS 4
+#define MAX_SEQL 8
+// most colours we support; sequences are read as decimal digits, one per peg
+#define MAX_COLS 9
+
+// answers are encoded in one value as exact*MATCH_BASE+approx; both counts are
+// at most MAX_SEQL, so the encoding is unambiguous for every supported length
+#define MATCH_BASE 10
+#define MATCH_ENCODE(exact, approx) ((exact) * MATCH_BASE + (approx))
+#define MATCH_EXACT(code) ((code) / MATCH_BASE)
+#define MATCH_APPROX(code) ((code) % MATCH_BASE)
+_Static_assert(MAX_SEQL < MATCH_BASE, "MATCH_BASE too small for MAX_SEQL");
+
+// settings of the code space the kernels work on, set by codesInit
+extern int codeSeqlen, codeColors;
+
+int codesInit(int seqlen, int colors);
+const char *codesKernelName(void);
+
+extern int (*countMatchesPacked)(seq_t seq1, seq_t seq2);
+void countMatchesBatch(seq_t guess, const seq_t *candidates, int n, unsigned char *out);
+
+seq_t parseSeq(int val);
+char *seqString(seq_t seq, char *buf);
+
+/* pack the sequence @seq@ of length @len@ into one word */
+static inline seq_t packSeq(const int *seq, int len)
+{
+  seq_t p = 0;
+  for (int i = len - 1; i >= 0; i--)
+    p = (p << PEG_BITS) | (seq_t)seq[i];
+  return p;
+}
+
+/* unpack @seq@ into the @len@ entries of @out@ */
+static inline void unpackSeq(seq_t seq, int *out, int len)
+{
+  for (int i = 0; i < len; i++, seq >>= PEG_BITS)
+    out[i] = seq & 0xF;
+}
+
+/* the colour of peg @i@ of @seq@ */
+static inline int getPeg(seq_t seq, int i)
+{
+  return (seq >> (i * PEG_BITS)) & 0xF;
+}
+
+/* @seq@ with peg @i@ set to colour @c@ */
+static inline seq_t setPeg(seq_t seq, int i, int c)
+{
+  return (seq & ~((seq_t)0xF << (i * PEG_BITS))) | ((seq_t)c << (i * PEG_BITS));
+}
+
+#endif
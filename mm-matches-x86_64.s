@@ -0,0 +1,201 @@
+# The matching function of mm-matches.s, for x86-64 (System V ABI, GNU as syntax),
+# so that testm and benchm can compare the C and the Assembler versions on PCs and
+# servers as well. The Makefile assembles this file instead of mm-matches.s when
+# `uname -m` is x86_64. Both entry points follow the ARM version:
+#
+#   int matches(int *val1, int *val2)
+#   void matchesBatch(seq_t guess, const seq_t *codes, int n, unsigned char *out)
+#
+# matchesBatch uses the same method, see the comments in mm-matches.s. Only SSE2
+# is used, which every x86-64 CPU has, so there is no need to check the CPU at run time.
+#
+# -----------------------------------------------------------------------------
+
+.text
+.global         matches
+.global         matchesBatch
+
+# constants about the basic setup of the game: length of sequence and number of colors
+.equ LEN, 3
+.equ COL, 3
+
+# count peg OFF of both sequences: exact matches in R10D, and the thermometer
+# counts per colour (colour c in bits 3c..3c+2) in R8D and R9D; adding the old
+# counter of colour c to the word shifts it left by one, and BTS adds the new 1
+.macro PEG off
+	movl	\off(%rdi), %eax
+	movl	\off(%rsi), %edx
+	xorl	%r11d, %r11d
+	cmpl	%edx, %eax
+	sete	%r11b
+	addl	%r11d, %r10d
+	leal	(%rax,%rax,2), %ecx	# 3*colour, the shift of its counter
+	movl	$7, %r11d
+	shll	%cl, %r11d
+	andl	%r8d, %r11d
+	addl	%r11d, %r8d
+	btsl	%ecx, %r8d
+	leal	(%rdx,%rdx,2), %ecx
+	movl	$7, %r11d
+	shll	%cl, %r11d
+	andl	%r9d, %r11d
+	addl	%r11d, %r9d
+	btsl	%ecx, %r9d
+.endm
+
+# RDI and RSI point to the two sequences, LEN ints each, colours 1..9;
+# returns exact*10+approx = exact*9+total in EAX, using no stack. The pegs of
+# each sequence are counted per colour in "thermometer" form: colour c owns
+# bits 3c..3c+2, and holds its number k of pegs as k ones from bit 3c up. The
+# AND of both words holds min(k1, k2) ones per colour; its popcount is total
+matches:
+	xorl	%r8d, %r8d
+	xorl	%r9d, %r9d
+	xorl	%r10d, %r10d
+	PEG	0
+	PEG	4
+	PEG	8
+
+	# total = popcount(R8D & R9D), at most LEN=3 bits, one cleared per step
+	andl	%r9d, %r8d
+	xorl	%eax, %eax
+	xorl	%ecx, %ecx
+	xorl	%edx, %edx
+	testl	%r8d, %r8d
+	setnz	%al
+	leal	-1(%r8), %r11d
+	andl	%r11d, %r8d
+	setnz	%cl
+	leal	-1(%r8), %r11d
+	andl	%r11d, %r8d
+	setnz	%dl
+	addl	%ecx, %eax
+	addl	%edx, %eax
+
+	# result = exact*9 + total
+	leal	(%r10,%r10,8), %r10d
+	addl	%r10d, %eax
+	ret
+
+# -----------------------------------------------------------------------------
+
+# XMM1 = nz(XMM1), the number of non-zero pegs per lane; XMM2 is scratch,
+# XMM8 holds 0x111 and XMM6 0xF in every lane
+.macro NZPEGS
+	movdqa	%xmm1, %xmm2
+	psrld	$2, %xmm2
+	por	%xmm2, %xmm1
+	movdqa	%xmm1, %xmm2
+	psrld	$1, %xmm2
+	por	%xmm2, %xmm1		# bit 4i set iff peg i is non-zero
+	pand	%xmm8, %xmm1
+	movdqa	%xmm1, %xmm2
+	psrld	$4, %xmm2
+	paddd	%xmm2, %xmm1
+	psrld	$4, %xmm2
+	paddd	%xmm2, %xmm1		# sum of those bits, in bits 0..3
+	pand	%xmm6, %xmm1
+.endm
+
+# score the codes in XMM0 into the low 4 bytes of XMM3
+.macro SCORE
+	movdqa	%xmm7, %xmm3		# LEN*9+LEN: all exact and all matched, then correct down
+	movdqa	%xmm0, %xmm1
+	pxor	%xmm9, %xmm1
+	NZPEGS
+	movdqa	%xmm1, %xmm2
+	pslld	$3, %xmm2
+	paddd	%xmm1, %xmm2
+	psubd	%xmm2, %xmm3		# - 9 * misplaced pegs
+	movdqa	%xmm0, %xmm1
+	pxor	%xmm10, %xmm1
+	NZPEGS
+	pcmpgtd	%xmm13, %xmm1		# -1 if guess peg 0 is not matched
+	paddd	%xmm1, %xmm3
+	movdqa	%xmm0, %xmm1
+	pxor	%xmm11, %xmm1
+	NZPEGS
+	pcmpgtd	%xmm14, %xmm1		# ... peg 1
+	paddd	%xmm1, %xmm3
+	movdqa	%xmm0, %xmm1
+	pxor	%xmm12, %xmm1
+	NZPEGS
+	pcmpgtd	%xmm15, %xmm1		# ... peg 2
+	paddd	%xmm1, %xmm3
+	packssdw	%xmm3, %xmm3
+	packuswb	%xmm3, %xmm3
+.endm
+
+# set all 4 lanes of XMM register X to the 32-bit register R
+.macro SPLAT r, x
+	movd	\r, \x
+	pshufd	$0, \x, \x
+.endm
+
+# score the packed guess in EDI against the EDX packed codes at RSI, 4 codes per
+# step, and store the answers, as encoded by matches, in the bytes at RCX
+matchesBatch:
+	testl	%edx, %edx
+	jle	3f
+	SPLAT	%edi, %xmm9		# the guess
+	movl	$0x111, %eax
+	SPLAT	%eax, %xmm8		# bit 0 of every peg
+	movl	$0xF, %eax
+	SPLAT	%eax, %xmm6
+	movl	$30, %eax
+	SPLAT	%eax, %xmm7
+	movl	%edi, %eax		# colour of guess peg 0, in every peg
+	andl	$0xF, %eax
+	imull	$0x111, %eax, %r8d
+	SPLAT	%r8d, %xmm10
+	movl	%edi, %r9d		# ... peg 1
+	shrl	$4, %r9d
+	andl	$0xF, %r9d
+	imull	$0x111, %r9d, %r8d
+	SPLAT	%r8d, %xmm11
+	movl	%edi, %r10d		# ... peg 2
+	shrl	$8, %r10d
+	andl	$0xF, %r10d
+	imull	$0x111, %r10d, %r8d
+	SPLAT	%r8d, %xmm12
+	movl	$2, %r8d		# LEN-rank for peg 0
+	SPLAT	%r8d, %xmm13
+	xorl	%r11d, %r11d		# ... peg 1: one less if it repeats peg 0
+	cmpl	%eax, %r9d
+	sete	%r11b
+	subl	%r11d, %r8d
+	SPLAT	%r8d, %xmm14
+	movl	$2, %r8d		# ... peg 2
+	xorl	%r11d, %r11d
+	cmpl	%eax, %r10d
+	sete	%r11b
+	subl	%r11d, %r8d
+	xorl	%r11d, %r11d
+	cmpl	%r9d, %r10d
+	sete	%r11b
+	subl	%r11d, %r8d
+	SPLAT	%r8d, %xmm15
+
+	subl	$4, %edx
+	jl	2f
+1:	movdqu	(%rsi), %xmm0
+	addq	$16, %rsi
+	SCORE
+	movd	%xmm3, (%rcx)
+	addq	$4, %rcx
+	subl	$4, %edx
+	jge	1b
+2:	addl	$4, %edx		# 0..3 codes left, one at a time
+	jz	3f
+4:	movd	(%rsi), %xmm0
+	addq	$4, %rsi
+	SCORE
+	movd	%xmm3, %eax
+	movb	%al, (%rcx)
+	incq	%rcx
+	decl	%edx
+	jnz	4b
+3:	ret
+
+# no executable stack needed
+.section .note.GNU-stack,"",@progbits
@@ -14,6 +14,7 @@
 .text
 @ this is the matching fct that should be called from the C part of the CW	
 .global         matches
+.global         matchesBatch
 @ use the name `main` here, for standalone testing of the assembler code
 @ when integrating this code into `master-mind.c`, choose a different name
 @ otw there will be a clash with the main function in the C code
@@ -171,6 +172,96 @@ matches:
 	ldr	fp, [sp], #4
 	bx	lr
 
+@ NEON version: score one guess against many codes, 4 codes per step
+@ void matchesBatch(seq_t guess, const seq_t *codes, int n, unsigned char *out)
+@ R0 is the guess and R1 the codes, packed as in mm-codes.h (peg i in bits 4i..4i+3,
+@ LEN=3 pegs); the n answers, as encoded by matches, go to the bytes at R3.
+@ Only Q0-Q3 and Q8-Q15 are used, so no callee-saved register needs saving.
+@ For x = code XOR pattern, nz(x) is the number of non-zero pegs of x: the pegs of
+@ the code that differ from the pattern. exact = LEN - nz(code XOR guess), and
+@ total counts the pegs i of the guess for which the code has at least rank(i)
+@ pegs of colour g(i), rank(i) being 1 for the first peg of that colour in the
+@ guess, 2 for the second, and so on; i.e. nz(code XOR g(i)*0x111) <= LEN-rank(i).
+@ This avoids finding the distinct colours of the guess in the inner loop.
+.syntax	unified
+.arch	armv7-a
+.fpu	neon
+
+@ Q1 = nz(Q1), per lane; Q2 is scratch, Q8 holds 0x111 in every lane
+.macro	NZPEGS
+	vshr.u32	q2, q1, #2
+	vorr	q1, q1, q2
+	vshr.u32	q2, q1, #1
+	vorr	q1, q1, q2		@ bit 4i set iff peg i is non-zero
+	vand	q1, q1, q8
+	vmul.i32	q1, q1, q8		@ sum of those bits, in bits 8..11
+	vshl.i32	q1, q1, #20
+	vshr.u32	q1, q1, #28
+.endm
+
+@ score the codes in Q0 into the low 4 bytes of D6
+.macro	SCORE
+	vmov.i32	q3, #27			@ LEN*9: all exact, then correct down
+	veor	q1, q0, q9
+	NZPEGS
+	vshl.i32	q2, q1, #3
+	vadd.i32	q2, q2, q1
+	vsub.i32	q3, q3, q2		@ - 9 * misplaced pegs
+	veor	q1, q0, q10
+	NZPEGS
+	vcge.u32	q2, q13, q1		@ -1 if guess peg 0 is matched
+	vsub.i32	q3, q3, q2
+	veor	q1, q0, q11
+	NZPEGS
+	vcge.u32	q2, q14, q1		@ ... peg 1
+	vsub.i32	q3, q3, q2
+	veor	q1, q0, q12
+	NZPEGS
+	vcge.u32	q2, q15, q1		@ ... peg 2
+	vsub.i32	q3, q3, q2
+	vmovn.i32	d6, q3
+	vmovn.i16	d6, q3
+.endm
+
+matchesBatch:
+	cmp	r2, #0
+	bxle	lr
+	vdup.32	q9, r0			@ the guess
+	movw	r12, #0x111
+	vdup.32	q8, r12			@ bit 0 of every peg
+	and	r12, r0, #0xF
+	vdup.32	q10, r12
+	vmul.i32	q10, q10, q8		@ colour of guess peg 0, in every peg
+	ubfx	r12, r0, #4, #4
+	vdup.32	q11, r12
+	vmul.i32	q11, q11, q8		@ ... peg 1
+	ubfx	r12, r0, #8, #4
+	vdup.32	q12, r12
+	vmul.i32	q12, q12, q8		@ ... peg 2
+	vmov.i32	q13, #2			@ LEN-rank for peg 0
+	vceq.i32	q2, q11, q10
+	vadd.i32	q14, q13, q2		@ ... peg 1: one less if it repeats peg 0
+	vceq.i32	q2, q12, q10
+	vadd.i32	q15, q13, q2
+	vceq.i32	q2, q12, q11
+	vadd.i32	q15, q15, q2		@ ... peg 2
+
+	subs	r2, r2, #4
+	blt	2f
+1:	vld1.32	{q0}, [r1]!
+	SCORE
+	vst1.32	{d6[0]}, [r3]!
+	subs	r2, r2, #4
+	bge	1b
+2:	adds	r2, r2, #4		@ 0..3 codes left, one at a time
+	bxeq	lr
+3:	vld1.32	{d0[0]}, [r1]!
+	SCORE
+	vst1.8	{d6[0]}, [r3]!
+	subs	r2, r2, #1
+	bne	3b
+	bx	lr
+
 @ show the sequence in R0, use a call to printf in libc to do the printing, a useful function when debugging 
 showseq:
     @ Optional
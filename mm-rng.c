@@ -0,0 +1,144 @@
+/* ***************************************************************************** */
+/* Seedable pseudo-random numbers and bulk secret generation; see mm-rng.h.      */
+/* ***************************************************************************** */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/random.h>
+
+#include "mm-rng.h"
+
+// seed of the per-thread streams of rngLocal, and the number of streams handed out
+static uint64_t rngBase;
+static int rngBaseSet;
+static unsigned int rngStreams;
+static pthread_once_t rngOnce = PTHREAD_ONCE_INIT;
+
+static __thread struct rngStruct rngTls;
+static __thread int rngTlsReady;
+
+/* splitmix64: spreads the bits of a seed, so that close seeds give unrelated states */
+static uint64_t rngSplitmix(uint64_t *x)
+{
+  uint64_t z = (*x += 0x9E3779B97F4A7C15ull);
+  z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+  z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+  return z ^ (z >> 31);
+}
+
+/* set @r@ to the state for @seed@; every seed, 0 included, gives a usable state */
+void rngSeed(struct rngStruct *r, uint64_t seed)
+{
+  int i;
+
+  for (i = 0; i < 4; i++)
+    r->s[i] = rngSplitmix(&seed);
+}
+
+/* advance @r@ by 2^128 draws */
+void rngJump(struct rngStruct *r)
+{
+  static const uint64_t jump[] = {0x180EC6D33CFD0ABAull, 0xD5A61266F0C9392Cull,
+                                  0xA9582618E03FC9AAull, 0x39ABDC4529B1661Cull};
+  uint64_t s[4] = {0, 0, 0, 0};
+  int i, b, k;
+
+  for (i = 0; i < 4; i++)
+    for (b = 0; b < 64; b++)
+    {
+      if (jump[i] & (1ull << b))
+        for (k = 0; k < 4; k++)
+          s[k] ^= r->s[k];
+      rngNext(r);
+    }
+  for (k = 0; k < 4; k++)
+    r->s[k] = s[k];
+}
+
+/* a seed that differs from run to run: from the kernel, or else the clock and pid */
+uint64_t rngSeedDefault(void)
+{
+  struct timespec ts;
+  uint64_t seed;
+
+  if (getrandom(&seed, sizeof(seed), GRND_NONBLOCK) == (ssize_t)sizeof(seed))
+    return seed;
+  clock_gettime(CLOCK_REALTIME, &ts);
+  seed = (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+  seed ^= (uint64_t)getpid() << 32;
+  return rngSplitmix(&seed);
+}
+
+/* seed the per-thread streams of rngLocal; call it before any thread draws */
+void rngSetSeed(uint64_t seed)
+{
+  rngBase = seed;
+  rngBaseSet = 1;
+}
+
+static void rngBaseInit(void)
+{
+  if (!rngBaseSet)
+    rngBase = rngSeedDefault();
+}
+
+/* the generator of the calling thread: the n-th thread that asks gets the seed */
+/* of rngSetSeed (or rngSeedDefault) jumped n times, so streams do not overlap */
+struct rngStruct *rngLocal(void)
+{
+  unsigned int n;
+
+  if (!rngTlsReady)
+  {
+    pthread_once(&rngOnce, rngBaseInit);
+    rngSeed(&rngTls, rngBase);
+    for (n = __atomic_fetch_add(&rngStreams, 1, __ATOMIC_RELAXED); n > 0; n--)
+      rngJump(&rngTls);
+    rngTlsReady = 1;
+  }
+  return &rngTls;
+}
+
+/* fill @out@ with @n@ uniformly random packed secrets of length @seqlen@ over */
+/* @colors@ colours; each 64-bit draw gives two pegs                             */
+void rngSecrets(struct rngStruct *r, int seqlen, int colors, seq_t *out, size_t n)
+{
+  uint32_t c = (uint32_t)colors, t = -c % c;
+  uint64_t bits = 0, m;
+  int j, have = 0;
+  size_t i;
+
+  for (i = 0; i < n; i++)
+  {
+    seq_t p = 0;
+    for (j = 0; j < seqlen; j++)
+    {
+      // the multiply-and-reject of rngBelow, on 32-bit halves of a draw
+      do
+      {
+        if (have == 0)
+        {
+          bits = rngNext(r);
+          have = 2;
+        }
+        m = (bits & 0xFFFFFFFFull) * c;
+        bits >>= 32;
+        have--;
+      } while ((uint32_t)m < t);
+      p |= (seq_t)((m >> 32) + 1) << (j * PEG_BITS);
+    }
+    out[i] = p;
+  }
+}
+
+/* one random packed secret */
+seq_t rngSecret(struct rngStruct *r, int seqlen, int colors)
+{
+  seq_t p;
+
+  rngSecrets(r, seqlen, colors, &p, 1);
+  return p;
+}
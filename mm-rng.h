@@ -0,0 +1,66 @@
+/* ***************************************************************************** */
+/* Fast, seedable pseudo-random numbers: xoshiro256** (Blackman and Vigna),      */
+/* seeded through splitmix64. The generator state is explicit, so every thread   */
+/* can own one, without the lock inside rand(), and a run can be reproduced from */
+/* one 64-bit seed. rngJump moves a state 2^128 draws ahead, which splits one    */
+/* seed into non-overlapping streams; rngLocal hands each thread its own stream. */
+/* rngSecrets fills an array with random packed secrets (see mm-codes.h).        */
+/* ***************************************************************************** */
+
+#ifndef MM_RNG_H
+#define MM_RNG_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "mm-codes.h"
+
+struct rngStruct
+{
+  uint64_t s[4];
+};
+
+void rngSeed(struct rngStruct *r, uint64_t seed);
+void rngJump(struct rngStruct *r);
+uint64_t rngSeedDefault(void);
+void rngSetSeed(uint64_t seed);
+struct rngStruct *rngLocal(void);
+seq_t rngSecret(struct rngStruct *r, int seqlen, int colors);
+void rngSecrets(struct rngStruct *r, int seqlen, int colors, seq_t *out, size_t n);
+
+static inline uint64_t rngRotl(uint64_t x, int k)
+{
+  return (x << k) | (x >> (64 - k));
+}
+
+/* the next 64 random bits from @r@ */
+static inline uint64_t rngNext(struct rngStruct *r)
+{
+  uint64_t *s = r->s;
+  uint64_t result = rngRotl(s[1] * 5, 7) * 9, t = s[1] << 17;
+
+  s[2] ^= s[0];
+  s[3] ^= s[1];
+  s[1] ^= s[2];
+  s[0] ^= s[3];
+  s[2] ^= t;
+  s[3] = rngRotl(s[3], 45);
+  return result;
+}
+
+/* a uniform random number in 0..@n@-1, for @n@ > 0; multiply and reject */
+/* (Lemire), so there is no modulo bias and, almost always, no division   */
+static inline uint32_t rngBelow(struct rngStruct *r, uint32_t n)
+{
+  uint64_t m = (rngNext(r) >> 32) * n;
+
+  if ((uint32_t)m < n)
+  {
+    uint32_t t = -n % n;
+    while ((uint32_t)m < t)
+      m = (rngNext(r) >> 32) * n;
+  }
+  return (uint32_t)(m >> 32);
+}
+
+#endif
@@ -0,0 +1,240 @@
+/* ***************************************************************************** */
+/* Whole-space simulator with per-thread work queues; see mm-sim.h.               */
+/* ***************************************************************************** */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+
+#include "mm-sim.h"
+
+// number of secrets a thread takes from the front of its own queue in one go
+#define SIM_CHUNK 4
+
+// a range [lo, hi) of secrets (code indices); cache-line aligned, so that
+// threads working on their own queues do not share cache lines
+struct simQueue
+{
+  pthread_mutex_t lock;
+  int lo, hi;
+} __attribute__((aligned(64)));
+
+// state of one worker thread
+struct simThread
+{
+  pthread_t thread;
+  int id, nthreads;
+  uint64_t seed;
+  struct solverStruct solver; // private solver state, on the shared code space
+  struct simQueue *queues;    // the queues of all threads
+  struct simResult *result;   // where guesses per secret are stored
+  long long total, steals;
+  int worst, failed;
+  int hist[SOLVER_MAX_GUESSES + 1];
+};
+
+/* take up to SIM_CHUNK secrets from the front of queue @q@; returns 0 if it is empty */
+static int simTake(struct simQueue *q, int *lo, int *hi)
+{
+  int ok;
+
+  pthread_mutex_lock(&q->lock);
+  ok = q->lo < q->hi;
+  if (ok)
+  {
+    *lo = q->lo;
+    *hi = q->lo + SIM_CHUNK < q->hi ? q->lo + SIM_CHUNK : q->hi;
+    q->lo = *hi;
+  }
+  pthread_mutex_unlock(&q->lock);
+  return ok;
+}
+
+/* move the back half of the range of some other thread into the own queue of */
+/* @t@; returns 0 if all other queues are empty, i.e. all work has been handed out */
+static int simSteal(struct simThread *t)
+{
+  int i, lo = 0, hi = 0;
+
+  for (i = 1; i < t->nthreads && lo == hi; i++)
+  {
+    struct simQueue *v = &t->queues[(t->id + i) % t->nthreads];
+
+    pthread_mutex_lock(&v->lock);
+    if (v->lo < v->hi)
+    {
+      lo = v->lo + (v->hi - v->lo) / 2;
+      hi = v->hi;
+      v->hi = lo;
+    }
+    pthread_mutex_unlock(&v->lock);
+  }
+  if (lo == hi)
+    return 0;
+
+  pthread_mutex_lock(&t->queues[t->id].lock);
+  t->queues[t->id].lo = lo;
+  t->queues[t->id].hi = hi;
+  pthread_mutex_unlock(&t->queues[t->id].lock);
+  t->steals++;
+  return 1;
+}
+
+/* thread body: play the secrets in the own queue, then steal, until no work is left */
+static void *simWorker(void *arg)
+{
+  struct simThread *t = (struct simThread *)arg;
+  int guesses[SOLVER_MAX_GUESSES];
+  int lo, hi, idx, n;
+  seq_t secret;
+
+  do
+  {
+    while (simTake(&t->queues[t->id], &lo, &hi))
+      for (idx = lo; idx < hi; idx++)
+      {
+        // seed the random strategy per secret, so that results do not depend on
+        // which thread happens to play which secret
+        rngSeed(&t->solver.rng, t->seed ^ (idx * 0x9E3779B97F4A7C15ull));
+        secret = t->result->secrets != NULL ? t->result->secrets[idx] : solverCode(&t->solver, idx);
+        n = solverPlay(&t->solver, secret, guesses);
+        if (n < 0)
+        {
+          t->failed++;
+          t->result->guesses[idx] = 0;
+          continue;
+        }
+        t->result->guesses[idx] = n;
+        t->total += n;
+        t->hist[n]++;
+        if (n > t->worst)
+          t->worst = n;
+      }
+  } while (simSteal(t));
+  return NULL;
+}
+
+static uint64_t simNowUs(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000ull + ts.tv_nsec / 1000;
+}
+
+/* play every secret of the code space of sequences of length @seqlen@ over      */
+/* @colors@ colours with @strategy@, on @nthreads@ threads, and summarise the    */
+/* results in @r@; @seed@ seeds SOLVER_RANDOM. With @nsecrets@ > 0, play that    */
+/* many random secrets instead, drawn from @seed@ (see rngSecrets), so a sample  */
+/* can be reproduced. If tableInit has been called for the same code space, all  */
+/* threads share the table. Returns 0 on success, or -1                          */
+int simRun(int seqlen, int colors, int strategy, int nthreads, uint64_t seed, int nsecrets, struct simResult *r)
+{
+  struct simThread *t;
+  struct simQueue *q;
+  int i, k, n, ok = 1;
+  uint64_t t0;
+
+  memset(r, 0, sizeof(*r));
+  if (nthreads < 1 || nthreads > SIM_MAX_THREADS)
+    return -1;
+  t = (struct simThread *)calloc(nthreads, sizeof(struct simThread));
+  q = (struct simQueue *)aligned_alloc(64, nthreads * sizeof(struct simQueue));
+  if (t == NULL || q == NULL)
+  {
+    free(t);
+    free(q);
+    return -1;
+  }
+
+  // set up all solvers before any thread starts, since solverInit also
+  // (re)initialises the kernels in mm-codes.c; the first one enumerates the
+  // code space, and the others share its list of codes, read-only
+  for (i = 0; i < nthreads && ok; i++)
+  {
+    ok = (i == 0 ? solverInit(&t[i].solver, seqlen, colors) : solverInitShared(&t[i].solver, &t[0].solver)) == 0;
+    t[i].solver.strategy = strategy;
+  }
+  n = nsecrets > 0 ? nsecrets : t[0].solver.ncodes;
+  r->guesses = ok ? (unsigned char *)malloc(n) : NULL;
+  if (ok && nsecrets > 0)
+  {
+    struct rngStruct rng;
+
+    t0 = simNowUs();
+    rngSeed(&rng, seed);
+    rngJump(&rng); // a stream of its own, apart from the per-secret seeds
+    r->secrets = (seq_t *)malloc(n * sizeof(seq_t));
+    if (r->secrets != NULL)
+      rngSecrets(&rng, seqlen, colors, r->secrets, n);
+    r->drawUs = simNowUs() - t0;
+  }
+  if (!ok || r->guesses == NULL || (nsecrets > 0 && r->secrets == NULL))
+  {
+    simFree(r);
+    for (k = 0; k < i; k++)
+      solverFree(&t[k].solver);
+    free(t);
+    free(q);
+    return -1;
+  }
+
+  t0 = simNowUs();
+  // the first minimax guess is the same for every secret: compute it once
+  if (strategy == SOLVER_MINIMAX)
+    for (i = 0; i < nthreads; i++)
+      t[i].solver.first = solverFirstGuess(&t[0].solver);
+
+  // hand out the secrets in equal, contiguous ranges; stealing evens out the rest
+  for (i = 0; i < nthreads; i++)
+  {
+    pthread_mutex_init(&q[i].lock, NULL);
+    q[i].lo = (int)((long long)n * i / nthreads);
+    q[i].hi = (int)((long long)n * (i + 1) / nthreads);
+    t[i].id = i;
+    t[i].nthreads = nthreads;
+    t[i].seed = seed;
+    t[i].queues = q;
+    t[i].result = r;
+  }
+  for (i = 1; i < nthreads; i++)
+    if (pthread_create(&t[i].thread, NULL, simWorker, &t[i]) != 0)
+    { // play on with fewer threads; the others steal this thread's share
+      t[i].nthreads = 0;
+      ok = 0;
+    }
+  simWorker(&t[0]);
+  for (i = 1; i < nthreads; i++)
+    if (t[i].nthreads > 0)
+      pthread_join(t[i].thread, NULL);
+
+  r->wallUs = simNowUs() - t0;
+  r->ncodes = n;
+  r->threads = nthreads;
+  for (i = 0; i < nthreads; i++)
+  {
+    r->total += t[i].total;
+    r->failed += t[i].failed;
+    r->steals += t[i].steals;
+    if (t[i].worst > r->worst)
+      r->worst = t[i].worst;
+    for (k = 0; k <= SOLVER_MAX_GUESSES; k++)
+      r->hist[k] += t[i].hist[k];
+    solverFree(&t[i].solver);
+    pthread_mutex_destroy(&q[i].lock);
+  }
+  if (!ok)
+    fprintf(stderr, "sim: could not start all %d threads\n", nthreads);
+  free(t);
+  free(q);
+  return 0;
+}
+
+void simFree(struct simResult *r)
+{
+  free(r->guesses);
+  free(r->secrets);
+  r->guesses = NULL;
+  r->secrets = NULL;
+}
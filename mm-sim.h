@@ -0,0 +1,39 @@
+/* ***************************************************************************** */
+/* Whole-space simulator: plays every secret of a code space against one of the  */
+/* solver strategies (see mm-solver.h), headless, on a pool of pthreads.         */
+/* Each thread owns a queue holding a range of secrets. It plays secrets from    */
+/* the front of its own range, and once that is empty it steals the back half of */
+/* the range of another thread, so the load stays balanced however much the cost */
+/* of single games varies.                                                       */
+/* ***************************************************************************** */
+
+#ifndef MM_SIM_H
+#define MM_SIM_H
+
+#include <stdint.h>
+
+#include "mm-solver.h"
+
+// most threads we start
+#define SIM_MAX_THREADS 256
+
+// summary of a run over the whole code space, or over a random sample of it
+struct simResult
+{
+  int ncodes;  // number of secrets played
+  int threads; // number of threads used
+  long long total; // sum of the guesses over all secrets
+  int worst;       // most guesses needed for a secret
+  int failed;      // secrets not found within SOLVER_MAX_GUESSES guesses
+  int hist[SOLVER_MAX_GUESSES + 1]; // number of secrets, per number of guesses
+  unsigned char *guesses; // guesses per secret, by code index or sample; 0 if not found
+  seq_t *secrets;         // the secrets of a sample, or NULL for the whole code space
+  long long steals;       // number of successful steals
+  uint64_t wallUs;        // wall time of the run, in microseconds
+  uint64_t drawUs;        // time taken to draw the sample, in microseconds
+};
+
+int simRun(int seqlen, int colors, int strategy, int nthreads, uint64_t seed, int nsecrets, struct simResult *r);
+void simFree(struct simResult *r);
+
+#endif
@@ -0,0 +1,220 @@
+/* ***************************************************************************** */
+/* Minimax (Knuth-style) solver for the MasterMind game; see mm-solver.h.        */
+/* Scoring goes through the precomputed answer table for small code spaces, and  */
+/* otherwise through countMatchesBatch, which scores one guess against all the   */
+/* candidates at once.                                                           */
+/* ***************************************************************************** */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "mm-solver.h"
+#include "mm-table.h"
+
+/* set up a solver for sequences of length @seqlen@ over @colors@ colours, on */
+/* the code list @packed@ if that is not NULL, and otherwise on its own one     */
+static int solverSetup(struct solverStruct *s, int seqlen, int colors, seq_t *packed)
+{
+  int i, j, n = 1;
+
+  for (i = 0; i < seqlen; i++)
+    n *= colors;
+
+  s->seqlen = seqlen;
+  s->colors = colors;
+  s->strategy = SOLVER_MINIMAX;
+  rngSeed(&s->rng, 1);
+  s->ncodes = n;
+  s->nresp = MATCH_ENCODE(seqlen, 0) + 1;
+  s->first = -1;
+  s->ncands = 0;
+  s->table = (tableCodes == n) ? matchTable : NULL;
+  s->cands = (int *)malloc(n * sizeof(int));
+  s->parts = (int *)malloc(s->nresp * sizeof(int));
+  s->isCand = (char *)malloc(n);
+  s->ownsPacked = packed == NULL;
+  s->packed = packed != NULL ? packed : (seq_t *)malloc(n * sizeof(seq_t));
+  s->candSeqs = (seq_t *)malloc(n * sizeof(seq_t));
+  s->answers = (unsigned char *)malloc(n);
+  if (s->cands == NULL || s->parts == NULL || s->isCand == NULL ||
+      s->packed == NULL || s->candSeqs == NULL || s->answers == NULL || codesInit(seqlen, colors) != 0)
+  {
+    solverFree(s);
+    return -1;
+  }
+  if (!s->ownsPacked)
+    return 0;
+
+  // enumerate the codes in lexicographic order: 11..1, 11..2, ...
+  for (i = 0; i < n; i++)
+  {
+    int val = i;
+    s->packed[i] = 0;
+    for (j = seqlen - 1; j >= 0; j--)
+    {
+      s->packed[i] = setPeg(s->packed[i], j, val % colors + 1);
+      val /= colors;
+    }
+  }
+  return 0;
+}
+
+/* set up the code space for sequences of length @seqlen@ over @colors@ colours; */
+/* if tableInit has been called for the same code space, the table is used     */
+int solverInit(struct solverStruct *s, int seqlen, int colors)
+{
+  return solverSetup(s, seqlen, colors, NULL);
+}
+
+/* set up @s@ for the code space of @owner@, sharing its (read-only) list of */
+/* codes; @owner@ has to outlive @s@                                          */
+int solverInitShared(struct solverStruct *s, const struct solverStruct *owner)
+{
+  return solverSetup(s, owner->seqlen, owner->colors, owner->packed);
+}
+
+void solverFree(struct solverStruct *s)
+{
+  free(s->cands);
+  free(s->parts);
+  free(s->isCand);
+  if (s->ownsPacked)
+    free(s->packed);
+  free(s->candSeqs);
+  free(s->answers);
+  s->cands = s->parts = NULL;
+  s->isCand = NULL;
+  s->packed = s->candSeqs = NULL;
+  s->answers = NULL;
+}
+
+/* return the sequence for the code with index @idx@ */
+seq_t solverCode(struct solverStruct *s, int idx)
+{
+  return s->packed[idx];
+}
+
+/* return the strategy called @name@ ("minimax", "first" or "random"), or -1 */
+int solverStrategy(const char *name)
+{
+  static const char *names[] = {"minimax", "first", "random"};
+  int i;
+
+  for (i = 0; i < (int)(sizeof(names) / sizeof(names[0])); i++)
+    if (strcmp(name, names[i]) == 0)
+      return i;
+  return -1;
+}
+
+/* pick the next guess according to the strategy; for minimax, this is the guess */
+/* that minimises the largest partition of the candidates, and ties are broken in */
+/* favour of candidates, then of the lowest code index                            */
+static int solverNextGuess(struct solverStruct *s)
+{
+  int g, k, best = -1, bestWorst = s->ncands + 1, bestIsCand = 0;
+
+  if (s->ncands == 1 || s->strategy == SOLVER_FIRST)
+    return s->cands[0];
+  if (s->strategy == SOLVER_RANDOM)
+    return s->cands[rngBelow(&s->rng, s->ncands)];
+
+  memset(s->isCand, 0, s->ncodes);
+  for (k = 0; k < s->ncands; k++)
+    s->isCand[s->cands[k]] = 1;
+
+  for (g = 0; g < s->ncodes; g++)
+  {
+    int worst = 0, pruned = 0;
+
+    memset(s->parts, 0, s->nresp * sizeof(int));
+    if (s->table == NULL)
+      countMatchesBatch(s->packed[g], s->candSeqs, s->ncands, s->answers);
+    for (k = 0; k < s->ncands; k++)
+    {
+      int r = s->table != NULL ? s->table[s->cands[k] * s->ncodes + g] : s->answers[k];
+      if (++s->parts[r] > worst)
+      {
+        worst = s->parts[r];
+        // stop as soon as this guess can no longer beat the best one
+        if (worst > bestWorst || (worst == bestWorst && (bestIsCand || !s->isCand[g])))
+        {
+          pruned = 1;
+          break;
+        }
+      }
+    }
+    if (pruned)
+      continue;
+
+    best = g;
+    bestWorst = worst;
+    bestIsCand = s->isCand[g];
+  }
+  return best;
+}
+
+/* make every code a candidate again */
+static void solverReset(struct solverStruct *s)
+{
+  int i;
+
+  s->ncands = s->ncodes;
+  for (i = 0; i < s->ncodes; i++)
+  {
+    s->cands[i] = i;
+    s->candSeqs[i] = s->packed[i];
+  }
+}
+
+/* return the first minimax guess; it only depends on the code space, so it is */
+/* computed once, and can be copied into other solvers for the same code space  */
+int solverFirstGuess(struct solverStruct *s)
+{
+  if (s->first < 0)
+  {
+    int strategy = s->strategy;
+    s->strategy = SOLVER_MINIMAX;
+    solverReset(s);
+    s->first = solverNextGuess(s);
+    s->strategy = strategy;
+  }
+  return s->first;
+}
+
+/* play the game against @secret@; store the indices of the guesses in @guesses@ */
+/* (at least SOLVER_MAX_GUESSES entries) and return the number of guesses made,  */
+/* or -1 if the secret was not found                                             */
+int solverPlay(struct solverStruct *s, seq_t secret, int *guesses)
+{
+  int i, k, n = 0, guess, win = MATCH_ENCODE(s->seqlen, 0);
+
+  if (s->strategy == SOLVER_MINIMAX)
+    solverFirstGuess(s);
+  solverReset(s);
+  guess = s->strategy == SOLVER_MINIMAX ? s->first : solverNextGuess(s);
+
+  while (n < SOLVER_MAX_GUESSES)
+  {
+    int res = countMatchesPacked(secret, s->packed[guess]);
+
+    guesses[n++] = guess;
+    if (res == win)
+      return n;
+
+    // keep only the candidates that would have given the same answer
+    countMatchesBatch(s->packed[guess], s->candSeqs, s->ncands, s->answers);
+    for (i = 0, k = 0; i < s->ncands; i++)
+      if (s->answers[i] == res)
+      {
+        s->cands[k] = s->cands[i];
+        s->candSeqs[k++] = s->candSeqs[i];
+      }
+    s->ncands = k;
+    if (k == 0)
+      return -1;
+
+    guess = solverNextGuess(s);
+  }
+  return -1;
+}
@@ -0,0 +1,52 @@
+/* ***************************************************************************** */
+/* Minimax (Knuth-style) solver for the MasterMind game.                         */
+/* The solver enumerates the whole code space, keeps the list of secrets that    */
+/* are still consistent with all answers so far, and picks as next guess the     */
+/* code that minimises the size of the largest partition of those candidates.    */
+/* Two cheaper strategies, that just guess the first or a random candidate, are  */
+/* there for code spaces too large for minimax.                                  */
+/* ***************************************************************************** */
+
+#ifndef MM_SOLVER_H
+#define MM_SOLVER_H
+
+#include "mm-codes.h"
+#include "mm-rng.h"
+
+// upper bound on the number of guesses the solver will make for one secret
+#define SOLVER_MAX_GUESSES 32
+
+// strategies for picking the next guess
+#define SOLVER_MINIMAX 0 // minimise the largest partition of the candidates
+#define SOLVER_FIRST 1   // the first candidate, in lexicographic order
+#define SOLVER_RANDOM 2  // a random candidate, drawn using rng
+
+// state of one solver instance; the code space is shared by all games it plays
+struct solverStruct
+{
+  int seqlen, colors;
+  int strategy; // one of the SOLVER_* strategies above, SOLVER_MINIMAX by default
+  struct rngStruct rng; // random number generator for SOLVER_RANDOM
+  int ncodes;   // size of the code space, colors^seqlen
+  int nresp;    // number of encoded responses (see MATCH_ENCODE in mm-codes.h)
+  int first;    // cached first guess (index into codes), -1 if not yet computed
+  int ncands;   // number of candidates still consistent with the answers
+  int *cands;   // indices of those candidates
+  int *parts;   // scratch: partition sizes, one per encoded response
+  char *isCand; // scratch: flag per code, set if the code is a candidate
+  unsigned char *table; // all-pairs answer table (see mm-table.h), or NULL
+  seq_t *packed;          // all codes, packed (see mm-codes.h), in lexicographic order
+  int ownsPacked;         // 0 if packed belongs to another solver (see solverInitShared)
+  seq_t *candSeqs;        // the candidates, packed, in the same order as cands
+  unsigned char *answers; // scratch: answers from countMatchesBatch
+};
+
+int solverInit(struct solverStruct *s, int seqlen, int colors);
+int solverInitShared(struct solverStruct *s, const struct solverStruct *owner);
+void solverFree(struct solverStruct *s);
+seq_t solverCode(struct solverStruct *s, int idx);
+int solverStrategy(const char *name);
+int solverFirstGuess(struct solverStruct *s);
+int solverPlay(struct solverStruct *s, seq_t secret, int *guesses);
+
+#endif
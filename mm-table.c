@@ -0,0 +1,76 @@
+/* ***************************************************************************** */
+/* Precomputed all-pairs answer table; see mm-table.h.                           */
+/* ***************************************************************************** */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "mm-table.h"
+
+unsigned char *matchTable = NULL;
+int tableCodes = 0;
+
+static int tableSeqlen, tableColors;
+
+/* the index of the code @seq@ in lexicographic order */
+int tableIndex(int *seq)
+{
+  int i, idx = 0;
+
+  for (i = 0; i < tableSeqlen; i++)
+    idx = idx * tableColors + (seq[i] - 1);
+  return idx;
+}
+
+/* build the table for sequences of length @seqlen@ over @colors@ colours,     */
+/* using the matching fct @score@; returns -1 if the code space is too large */
+int tableInit(int seqlen, int colors, int (*score)(int *seq1, int *seq2))
+{
+  int i, j, k, n = 1;
+  int *codes;
+
+  for (i = 0; i < seqlen; i++)
+  {
+    n *= colors;
+    if (n > TABLE_MAX_CODES)
+      return -1;
+  }
+
+  tableFree();
+  codes = (int *)malloc(n * seqlen * sizeof(int));
+  matchTable = (unsigned char *)malloc((size_t)n * n);
+  if (codes == NULL || matchTable == NULL)
+  {
+    free(codes);
+    tableFree();
+    return -1;
+  }
+  tableSeqlen = seqlen;
+  tableColors = colors;
+  tableCodes = n;
+
+  for (i = 0; i < n; i++)
+  {
+    int val = i;
+    for (k = seqlen - 1; k >= 0; k--)
+    {
+      codes[i * seqlen + k] = val % colors + 1;
+      val /= colors;
+    }
+  }
+
+  // the answer is symmetric in secret and guess, so score each pair once
+  for (i = 0; i < n; i++)
+    for (j = i; j < n; j++)
+      matchTable[i * n + j] = matchTable[j * n + i] = score(codes + i * seqlen, codes + j * seqlen);
+
+  free(codes);
+  return 0;
+}
+
+void tableFree(void)
+{
+  free(matchTable);
+  matchTable = NULL;
+  tableCodes = 0;
+}
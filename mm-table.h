@@ -0,0 +1,28 @@
+/* ***************************************************************************** */
+/* Precomputed table of the answers for all (secret, guess) pairs of a small     */
+/* code space. Codes are indexed by their position in lexicographic order, so    */
+/* for a 3x3 game 111 is code 0, 112 is code 1, ..., 333 is code 26.             */
+/* Once the table is built, scoring a pair is a single load.                     */
+/* ***************************************************************************** */
+
+#ifndef MM_TABLE_H
+#define MM_TABLE_H
+
+// largest code space we build a table for (4096^2 bytes = 16MB)
+#define TABLE_MAX_CODES 4096
+
+// encoded answers (see MATCH_ENCODE in mm-codes.h), indexed by secret*tableCodes+guess
+extern unsigned char *matchTable;
+extern int tableCodes;
+
+int tableInit(int seqlen, int colors, int (*score)(int *seq1, int *seq2));
+void tableFree(void);
+int tableIndex(int *seq);
+
+/* look up the encoded answer for the codes with indices @secret@ and @guess@ */
+static inline int tableMatches(int secret, int guess)
+{
+  return matchTable[secret * tableCodes + guess];
+}
+
+#endif
@@ -115,6 +115,35 @@ EOS
 )
 check
 
+# the same pairs again, scored by one process in streaming mode
+cmd="./${cw} -U"
+out="`printf '123 321\n121 313\n132 321\n123 112\n112 233\n111 333\n331 223\n331 232\n232 331\n312 312\n' | $cmd`"
+exp=$(cat <<EOS
+1 2
+0 1
+0 3
+1 1
+0 1
+0 0
+0 1
+1 0
+1 0
+3 0
+EOS
+)
+check
+
+# malformed lines are answered with "invalid", empty lines are skipped
+cmd="./${cw} -U"
+out="`printf '123 321\n12\n\n312 312\n' | $cmd 2>/dev/null`"
+exp=$(cat <<EOS
+1 2
+invalid
+3 0
+EOS
+)
+check
+
 # return status code (0 for ok, 1 for not)
 echo "$ok of $n tests are OK"
 exit $ret
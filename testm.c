@@ -5,6 +5,14 @@ $ as  -o mm-matches.o mm-matches.s
 $ gcc -c -o testm.o testm.c
 $ gcc -o testm testm.o mm-matches.o
 $ ./testm
+
+  This only checks the results; for timings of the different versions see benchm.c (make bench)
+
+$ ./testm -x [-L <length>] [-C <colours>] [-t <threads>]
+
+  checks every version of the matching fct against the C version on every pair
+  of sequences of the given code space, splitting the work over all cores, and
+  the set of candidates (mm-cands.c) against brute force, on a few games
 */
 
 #include <stdio.h>
@@ -12,8 +20,19 @@ $ ./testm
 #include <stdint.h>
 #include <string.h>
 #include <unistd.h>
+#include <time.h>
+#include <pthread.h>
 
-#include <sys/time.h>
+#if defined(__arm__)
+#include <sys/auxv.h>
+#ifndef HWCAP_NEON
+#define HWCAP_NEON (1 << 12)
+#endif
+#endif
+
+#include "mm-table.h"
+#include "mm-codes.h"
+#include "mm-cands.h"
 
 #define LENGTH 3
 #define COLORS 3
@@ -21,8 +40,8 @@ $ ./testm
 #define NAN1 8
 #define NAN2 9
 
-const int seqlen = LENGTH;
-const int seqmax = COLORS;
+static int seqlen = LENGTH;
+static int seqmax = COLORS;
 
 /* ********************************** */
 /* take these fcts from master-mind.c */
@@ -55,7 +74,7 @@ const int seqmax = COLORS;
 void showSeq(int *seq)
 {
   printf("Secret: ");
-  for (int i = 0; i < 3; i++)
+  for (int i = 0; i < seqlen; i++)
   {
     printf("%d ", seq[i]);
   }
@@ -73,11 +92,11 @@ int /* or int* */ countMatches(int *seq1, int *seq2)
   int exactMatches = 0;
   int approximateMatches = 0;
 
-  int seq1Matched[3] = {0};
-  int seq2Matched[3] = {0};
+  int seq1Matched[MAX_SEQL] = {0};
+  int seq2Matched[MAX_SEQL] = {0};
 
   // Count exact matches
-  for (int i = 0; i < 3; i++)
+  for (int i = 0; i < seqlen; i++)
   {
     if (seq1[i] == seq2[i])
     {
@@ -88,11 +107,11 @@ int /* or int* */ countMatches(int *seq1, int *seq2)
   }
 
   // Count approximate matches
-  for (int i = 0; i < 3; i++)
+  for (int i = 0; i < seqlen; i++)
   {
     if (!seq1Matched[i])
     {
-      for (int j = 0; j < 3; j++)
+      for (int j = 0; j < seqlen; j++)
       {
         if (!seq2Matched[j] && seq1[i] == seq2[j])
         {
@@ -105,7 +124,7 @@ int /* or int* */ countMatches(int *seq1, int *seq2)
     }
   }
 
-  return exactMatches * 10 + approximateMatches;
+  return MATCH_ENCODE(exactMatches, approximateMatches);
 }
 
 /* show the results from calling countMatches on seq1 and seq1 */
@@ -170,20 +189,327 @@ int readNum(int max)
 // The ARM assembler version of the matching fct
 extern int /* or int* */ matches(int *val1, int *val2);
 
+// its batch entry (NEON, or SSE2 on x86-64), scoring one packed guess against
+// many packed codes (3 pegs)
+extern void matchesBatch(seq_t guess, const seq_t *codes, int n, unsigned char *out);
+
+/* 1 if this CPU can run matchesBatch: 32-bit ARM cores may lack NEON, so ask */
+/* the kernel; the rest of this program is built without NEON, to run anyway */
+static int haveMatchesBatch(void)
+{
+#if defined(__arm__)
+  return (getauxval(AT_HWCAP) & HWCAP_NEON) != 0;
+#else
+  return 1;
+#endif
+}
+
+/* ***************************************************************************** */
+/* exhaustive check: every version of the matching fct against the C version,    */
+/* on every (secret, guess) pair of the code space, using one thread per core    */
+/* ***************************************************************************** */
+
+// versions checked against the C version
+#define CHECK_ASM 0
+#define CHECK_TABLE 1
+#define CHECK_PACKED 2
+#define CHECK_BATCH 3
+#define CHECK_ASM_BATCH 4
+#define CHECK_VERSIONS 5
+// number of secrets a thread takes from the shared counter in one go
+#define CHECK_CHUNK 64
+// largest code space we check (2^32 pairs; 8x4 and 6x6 are 2^32 and 2^31)
+#define CHECK_MAX_CODES (1 << 16)
+
+static const char *checkNames[CHECK_VERSIONS] = {"asm", "table", "packed", "batch", "asmbat"};
+
+static int checkCodes;     // size of the code space
+static seq_t *checkPacked; // all codes, packed, in lexicographic order
+static int *checkInts;     // all codes, MAX_SEQL ints each, in the same order
+static int checkNext;      // next secret to hand out, shared by all threads
+static int checkAsmBatch;  // 1 if matchesBatch is checked: 3 pegs, and a CPU that runs it
+
+// per-thread results; only the first mismatch of each version is kept
+struct checkStruct
+{
+  pthread_t thread;
+  int ok; // 0 if the thread ran out of memory
+  long long pairs;
+  long long wrong[CHECK_VERSIONS];
+  int secret[CHECK_VERSIONS], guess[CHECK_VERSIONS], res[CHECK_VERSIONS], res_c[CHECK_VERSIONS];
+};
+
+/* thread body: take chunks of secrets until all are done, and score each of */
+/* them against all guesses with every version of the matching fct           */
+static void *checkWorker(void *arg)
+{
+  struct checkStruct *c = (struct checkStruct *)arg;
+  unsigned char *batch = (unsigned char *)malloc(checkCodes);
+  unsigned char *asmBatch = (unsigned char *)malloc(checkCodes);
+  int cpy1[MAX_SEQL], cpy2[MAX_SEQL], res[CHECK_VERSIONS];
+  int first, last, s, g, k, res_c;
+
+  c->ok = (batch != NULL && asmBatch != NULL);
+  while (c->ok && (first = __atomic_fetch_add(&checkNext, CHECK_CHUNK, __ATOMIC_RELAXED)) < checkCodes)
+  {
+    last = first + CHECK_CHUNK < checkCodes ? first + CHECK_CHUNK : checkCodes;
+    for (s = first; s < last; s++)
+    {
+      int *seq1 = checkInts + s * MAX_SEQL;
+
+      countMatchesBatch(checkPacked[s], checkPacked, checkCodes, batch);
+      if (checkAsmBatch)
+        matchesBatch(checkPacked[s], checkPacked, checkCodes, asmBatch);
+      for (g = 0; g < checkCodes; g++)
+      {
+        int *seq2 = checkInts + g * MAX_SEQL;
+
+        res_c = countMatches(seq1, seq2);
+        // the Assembler version is hard-wired to 3 pegs, and may modify its inputs
+        if (seqlen == 3)
+        {
+          memcpy(cpy1, seq1, seqlen * sizeof(int));
+          memcpy(cpy2, seq2, seqlen * sizeof(int));
+          res[CHECK_ASM] = matches(cpy1, cpy2);
+        }
+        else
+          res[CHECK_ASM] = res_c;
+        res[CHECK_TABLE] = matchTable != NULL ? tableMatches(s, g) : res_c;
+        res[CHECK_PACKED] = countMatchesPacked(checkPacked[s], checkPacked[g]);
+        res[CHECK_BATCH] = batch[g];
+        res[CHECK_ASM_BATCH] = checkAsmBatch ? asmBatch[g] : res_c;
+
+        for (k = 0; k < CHECK_VERSIONS; k++)
+          if (res[k] != res_c && c->wrong[k]++ == 0)
+          {
+            c->secret[k] = s;
+            c->guess[k] = g;
+            c->res[k] = res[k];
+            c->res_c[k] = res_c;
+          }
+      }
+      c->pairs += checkCodes;
+    }
+  }
+  free(batch);
+  free(asmBatch);
+  return NULL;
+}
+
+/* check all pairs of the current code space, using @nthreads@ threads; */
+/* returns the number of mismatches found, or -1 on error               */
+static long long checkAll(int nthreads)
+{
+  struct checkStruct *c;
+  struct timespec t0, t1;
+  long long pairs = 0, wrong[CHECK_VERSIONS] = {0}, total = 0;
+  int i, j, k, ok = 1;
+  char str1[MAX_SEQL + 1], str2[MAX_SEQL + 1];
+
+  for (i = 0, checkCodes = 1; i < seqlen; i++)
+  {
+    checkCodes *= seqmax;
+    if (checkCodes > CHECK_MAX_CODES)
+    {
+      fprintf(stderr, "Code space %dx%d is too large for an exhaustive check\n", seqlen, seqmax);
+      return -1;
+    }
+  }
+  checkPacked = (seq_t *)malloc(checkCodes * sizeof(seq_t));
+  checkInts = (int *)malloc(checkCodes * MAX_SEQL * sizeof(int));
+  c = (struct checkStruct *)calloc(nthreads, sizeof(struct checkStruct));
+  if (checkPacked == NULL || checkInts == NULL || c == NULL)
+  {
+    fprintf(stderr, "Out of memory\n");
+    return -1;
+  }
+
+  // enumerate the codes in lexicographic order, the order the table uses
+  for (i = 0; i < checkCodes; i++)
+  {
+    int val = i, *seq = checkInts + i * MAX_SEQL;
+    for (j = seqlen - 1; j >= 0; j--)
+    {
+      seq[j] = val % seqmax + 1;
+      val /= seqmax;
+    }
+    checkPacked[i] = packSeq(seq, seqlen);
+  }
+
+  fprintf(stderr, "Checking all %lld pairs of %dx%d sequences with %d threads ...\n",
+          (long long)checkCodes * checkCodes, seqlen, seqmax, nthreads);
+  clock_gettime(CLOCK_MONOTONIC, &t0);
+  checkNext = 0;
+  checkAsmBatch = seqlen == 3 && haveMatchesBatch();
+  for (i = 0; i < nthreads; i++)
+    if (pthread_create(&c[i].thread, NULL, checkWorker, &c[i]) != 0)
+    {
+      fprintf(stderr, "Failed to create thread %d\n", i);
+      exit(EXIT_FAILURE);
+    }
+  for (i = 0; i < nthreads; i++)
+  {
+    pthread_join(c[i].thread, NULL);
+    ok &= c[i].ok;
+    pairs += c[i].pairs;
+  }
+  clock_gettime(CLOCK_MONOTONIC, &t1);
+
+  for (k = 0; k < CHECK_VERSIONS; k++)
+  {
+    int first = -1;
+    for (i = 0; i < nthreads; i++)
+    {
+      if (c[i].wrong[k] > 0 && first < 0)
+        first = i;
+      wrong[k] += c[i].wrong[k];
+    }
+    total += wrong[k];
+    if (((k == CHECK_ASM || k == CHECK_ASM_BATCH) && seqlen != 3) || (k == CHECK_TABLE && matchTable == NULL))
+      fprintf(stdout, "%-6s: skipped for %dx%d\n", checkNames[k], seqlen, seqmax);
+    else if (k == CHECK_ASM_BATCH && !checkAsmBatch)
+      fprintf(stdout, "%-6s: skipped, this CPU has no NEON\n", checkNames[k]);
+    else if (wrong[k] == 0)
+      fprintf(stdout, "%-6s: __ all results OK\n", checkNames[k]);
+    else
+      fprintf(stdout, "%-6s: ** %lld results WRONG, e.g. %s vs %s gives %d instead of %d\n",
+              checkNames[k], wrong[k],
+              seqString(checkPacked[c[first].secret[k]], str1), seqString(checkPacked[c[first].guess[k]], str2),
+              c[first].res[k], c[first].res_c[k]);
+  }
+  {
+    double secs = (t1.tv_sec - t0.tv_sec) + (t1.tv_nsec - t0.tv_nsec) / 1e9;
+    fprintf(stderr, "%lld pairs checked in %.3f s (%.1f million pairs/s)\n",
+            pairs, secs, secs > 0 ? pairs / secs / 1e6 : 0.0);
+  }
+
+  free(c);
+  free(checkPacked);
+  free(checkInts);
+  if (!ok)
+  {
+    fprintf(stderr, "Out of memory\n");
+    return -1;
+  }
+  return total;
+}
+
+// games, and guesses per game, played by checkCands
+#define CHECK_CAND_GAMES 8
+#define CHECK_CAND_GUESSES 6
+
+/* check the set of candidates against brute force: play a few games on the code */
+/* space, with random secrets and guesses, prune the set after every guess (all  */
+/* at once, or one word per candPruneStep, in turn), and compare its contents,   */
+/* size, candNext and candList with filtering all codes by the C version.        */
+/* Returns the number of mismatches found, or -1 on error                       */
+static long long checkCands(void)
+{
+  struct candStruct c;
+  seq_t *packed, *list;
+  int *ints;
+  char *alive;
+  long long wrong = 0;
+  int i, j, k, n, game, round, secret, guess, answer, count, idx;
+  char str1[MAX_SEQL + 1], str2[MAX_SEQL + 1];
+
+  for (i = 0, n = 1; i < seqlen; i++)
+    n *= seqmax;
+  packed = (seq_t *)malloc(n * sizeof(seq_t));
+  list = (seq_t *)malloc(n * sizeof(seq_t));
+  ints = (int *)malloc(n * MAX_SEQL * sizeof(int));
+  alive = (char *)malloc(n);
+  if (packed == NULL || list == NULL || ints == NULL || alive == NULL || candInit(&c, seqlen, seqmax) != 0)
+  {
+    fprintf(stderr, "Out of memory\n");
+    return -1;
+  }
+  // the codes in lexicographic order, which candCode has to follow
+  for (i = 0; i < n; i++)
+  {
+    int val = i, *seq = ints + i * MAX_SEQL;
+    for (j = seqlen - 1; j >= 0; j--)
+    {
+      seq[j] = val % seqmax + 1;
+      val /= seqmax;
+    }
+    packed[i] = packSeq(seq, seqlen);
+    if (candCode(&c, i) != packed[i] && wrong++ == 0)
+      fprintf(stdout, "cands : ** code %d is %s instead of %s\n", i, seqString(candCode(&c, i), str1),
+              seqString(packed[i], str2));
+  }
+
+  srand(1701);
+  for (game = 0; game < CHECK_CAND_GAMES; game++)
+  {
+    candReset(&c);
+    memset(alive, 1, n);
+    secret = rand() % n;
+    for (round = 0; round < CHECK_CAND_GUESSES && c.count > 1; round++)
+    {
+      guess = rand() % n;
+      answer = countMatches(ints + secret * MAX_SEQL, ints + guess * MAX_SEQL);
+      if (round % 2 == 0)
+        candPrune(&c, packed[guess], answer);
+      else
+        for (candPruneStart(&c, packed[guess], answer); !candPruneStep(&c, 1);)
+          ;
+
+      for (i = 0, count = 0; i < n; i++)
+      {
+        alive[i] &= countMatches(ints + i * MAX_SEQL, ints + guess * MAX_SEQL) == answer;
+        count += alive[i];
+        if (candHas(&c, i) != alive[i] && wrong++ == 0)
+          fprintf(stdout, "cands : ** code %s after guess %s: %d instead of %d\n",
+                  seqString(packed[i], str1), seqString(packed[guess], str2), candHas(&c, i), alive[i]);
+      }
+      if (c.count != count && wrong++ == 0)
+        fprintf(stdout, "cands : ** %d candidates instead of %d\n", c.count, count);
+
+      // candNext and candList walk the same codes, in order
+      if (candList(&c, list, n) != count && wrong++ == 0)
+        fprintf(stdout, "cands : ** candList gives the wrong number of candidates\n");
+      for (i = 0, k = 0, idx = candNext(&c, 0); i < n; i++)
+        if (alive[i])
+        {
+          if ((idx != i || (k < count && list[k] != packed[i])) && wrong++ == 0)
+            fprintf(stdout, "cands : ** candNext or candList misses %s\n", seqString(packed[i], str1));
+          k++;
+          idx = candNext(&c, i + 1);
+        }
+      if (idx != -1 && wrong++ == 0)
+        fprintf(stdout, "cands : ** candNext goes past the last candidate\n");
+    }
+  }
+  if (wrong == 0)
+    fprintf(stdout, "cands : __ all results OK\n");
+  else
+    fprintf(stdout, "cands : ** %lld results WRONG\n", wrong);
+
+  candFree(&c);
+  free(packed);
+  free(list);
+  free(ints);
+  free(alive);
+  return wrong;
+}
+
 // +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
 
 int main(int argc, char **argv)
 {
-  int res, res_c, t, t_c, m, n;
+  int res, res_c, res_t, res_b, res_p, m, n;
+  seq_t packed1;
+  unsigned char answer;
   int *seq1, *seq2, *cpy1, *cpy2;
-  struct timeval t1, t2;
   char str_in[20], str[20] = "some text";
-  int verbose = 0, debug = 0, help = 0, opt_s = 0, opt_n = 0;
+  int verbose = 0, debug = 0, help = 0, opt_s = 0, opt_n = 0, opt_x = 0;
+  int nthreads = (int)sysconf(_SC_NPROCESSORS_ONLN);
 
   // see: man 3 getopt for docu and an example of command line parsing
   { // see the CW spec for the intended meaning of these options
     int opt;
-    while ((opt = getopt(argc, argv, "hvs:n:")) != -1)
+    while ((opt = getopt(argc, argv, "hvxs:n:L:C:t:")) != -1)
     {
       switch (opt)
       {
@@ -202,18 +528,56 @@ int main(int argc, char **argv)
       case 'n':
         opt_n = atoi(optarg);
         break;
+      case 'x':
+        opt_x = 1;
+        break;
+      case 'L':
+        seqlen = atoi(optarg);
+        break;
+      case 'C':
+        seqmax = atoi(optarg);
+        break;
+      case 't':
+        nthreads = atoi(optarg);
+        break;
       default: /* '?' */
         fprintf(stderr, "Usage: %s [-h] [-v] [-s <seed>] [-n <no. of iterations>]  \n", argv[0]);
+        fprintf(stderr, "       %s -x [-L <length>] [-C <colours>] [-t <threads>]\n", argv[0]);
         exit(EXIT_FAILURE);
       }
     }
   }
 
+  // exhaustive check of all versions of the matching fct on a whole code space
+  if (opt_x)
+  {
+    if (codesInit(seqlen, seqmax) != 0 || nthreads < 1)
+    {
+      fprintf(stderr, "Unsupported settings\n");
+      exit(EXIT_FAILURE);
+    }
+    tableInit(seqlen, seqmax, countMatches); // no table for large code spaces
+    exit(checkAll(nthreads) == 0 && checkCands() == 0 ? EXIT_SUCCESS : EXIT_FAILURE);
+  }
+  if (seqlen != LENGTH || seqmax != COLORS)
+  {
+    fprintf(stderr, "Options -L and -C are only supported together with -x\n");
+    exit(EXIT_FAILURE);
+  }
+
   seq1 = (int *)malloc(seqlen * sizeof(int));
   seq2 = (int *)malloc(seqlen * sizeof(int));
   cpy1 = (int *)malloc(seqlen * sizeof(int));
   cpy2 = (int *)malloc(seqlen * sizeof(int));
 
+  // all-pairs answer table, built from the C version of the matching fct
+  if (tableInit(seqlen, seqmax, countMatches) != 0)
+  {
+    fprintf(stderr, "Failed to build the answer table\n");
+    exit(EXIT_FAILURE);
+  }
+  codesInit(seqlen, seqmax);
+
   if (argc > optind + 1)
   {
     strcpy(str_in, argv[optind]);
@@ -251,6 +615,11 @@ int main(int argc, char **argv)
       memcpy(seq1, cpy1, seqlen * sizeof(int));
       memcpy(seq2, cpy2, seqlen * sizeof(int));
       res_c = countMatches(seq1, seq2); // local C function
+      res_t = tableMatches(tableIndex(seq1), tableIndex(seq2));
+      packed1 = packSeq(seq1, seqlen);
+      countMatchesBatch(packSeq(seq2, seqlen), &packed1, 1, &answer);
+      res_b = answer;
+      res_p = countMatchesPacked(packed1, packSeq(seq2, seqlen));
       if (debug)
       {
         fprintf(stdout, "DBG: sequences after matching:\n");
@@ -259,12 +628,15 @@ int main(int argc, char **argv)
       }
       fprintf(stdout, "Matches (encoded) (in C):   %d\n", res_c);
       fprintf(stdout, "Matches (encoded) (in Asm): %d\n", res);
+      fprintf(stdout, "Matches (encoded) (table):  %d\n", res_t);
+      fprintf(stdout, "Matches (encoded) (batch):  %d\n", res_b);
+      fprintf(stdout, "Matches (encoded) (packed): %d\n", res_p);
       memcpy(seq1, cpy1, seqlen * sizeof(int));
       memcpy(seq2, cpy2, seqlen * sizeof(int));
       showMatches(res_c, seq1, seq2, 0);
       showMatches(res, seq1, seq2, 0);
       tot++;
-      if (res == res_c)
+      if (res == res_c && res_t == res_c && res_b == res_c && res_p == res_c)
       {
         fprintf(stdout, "__ result OK\n");
         oks++;
@@ -280,20 +652,20 @@ int main(int argc, char **argv)
 
   readSeq(seq1, m);
   readSeq(seq2, n);
+  // the table, like the packed versions, only knows the pegs 1..seqmax
+  for (int j = 0; j < seqlen; j++)
+    if (m < 0 || n < 0 || seq1[j] < 1 || seq1[j] > seqmax || seq2[j] < 1 || seq2[j] > seqmax)
+    {
+      fprintf(stderr, "Expected two sequences of %d digits between 1 and %d, got %d and %d\n", seqlen, seqmax, m, n);
+      exit(EXIT_FAILURE);
+    }
 
   memcpy(cpy1, seq1, seqlen * sizeof(int));
   memcpy(cpy2, seq2, seqlen * sizeof(int));
   memcpy(seq1, cpy1, seqlen * sizeof(int));
   memcpy(seq2, cpy2, seqlen * sizeof(int));
 
-  gettimeofday(&t1, NULL);
   res_c = countMatches(seq1, seq2); // local C function
-  gettimeofday(&t2, NULL);
-  // d = difftime(t1,t2);
-  if (t2.tv_usec < t1.tv_usec) // Counter wrapped
-    t_c = (1000000 + t2.tv_usec) - t1.tv_usec;
-  else
-    t_c = t2.tv_usec - t1.tv_usec;
 
   if (debug)
   {
@@ -304,14 +676,7 @@ int main(int argc, char **argv)
   memcpy(seq1, cpy1, seqlen * sizeof(int));
   memcpy(seq2, cpy2, seqlen * sizeof(int));
 
-  gettimeofday(&t1, NULL);
   res = matches(seq1, seq2); // extern; code in hamming4.s
-  gettimeofday(&t2, NULL);
-  // d = difftime(t1,t2);
-  if (t2.tv_usec < t1.tv_usec) // Counter wrapped
-    t = (1000000 + t2.tv_usec) - t1.tv_usec;
-  else
-    t = t2.tv_usec - t1.tv_usec;
 
   if (debug)
   {
@@ -322,10 +687,18 @@ int main(int argc, char **argv)
 
   memcpy(seq1, cpy1, seqlen * sizeof(int));
   memcpy(seq2, cpy2, seqlen * sizeof(int));
+  res_t = tableMatches(tableIndex(seq1), tableIndex(seq2));
+  packed1 = packSeq(seq1, seqlen);
+  countMatchesBatch(packSeq(seq2, seqlen), &packed1, 1, &answer);
+  res_b = answer;
+  res_p = countMatchesPacked(packed1, packSeq(seq2, seqlen));
   showMatches(res_c, seq1, seq2, 0);
   showMatches(res, seq1, seq2, 0);
+  showMatches(res_t, seq1, seq2, 0);
+  showMatches(res_b, seq1, seq2, 0);
+  showMatches(res_p, seq1, seq2, 0);
 
-  if (res == res_c)
+  if (res == res_c && res_t == res_c && res_b == res_c && res_p == res_c)
   {
     fprintf(stdout, "__ result OK\n");
   }
@@ -333,8 +706,11 @@ int main(int argc, char **argv)
   {
     fprintf(stdout, "** result WRONG\n");
   }
-  fprintf(stderr, "C   version:\t\tresult=%d (elapsed time: %dms)\n", res_c, t_c);
-  fprintf(stderr, "Asm version:\t\tresult=%d (elapsed time: %dms)\n", res, t);
+  fprintf(stderr, "C   version:\t\tresult=%d\n", res_c);
+  fprintf(stderr, "Asm version:\t\tresult=%d\n", res);
+  fprintf(stderr, "Table version:\t\tresult=%d\n", res_t);
+  fprintf(stderr, "Batch version:\t\tresult=%d (%s)\n", res_b, codesKernelName());
+  fprintf(stderr, "Packed version:\t\tresult=%d\n", res_p);
 
   return 0;
 }
\ No newline at end of file